@@ -0,0 +1,162 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : imgFeed.cpp
+//
+// DESCRIPTION :
+//    Training frames made ahead of the learner: a producer thread
+//    scales the samples and rolls them into movies, and hands the
+//    frames over through a lock-free ring, so the network update
+//    does not wait on image processing.
+
+#include "ring.h"
+#include <sched.h>
+#include <sys/time.h>
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STATIC FUNCTIONS DEFINED IN THIS FILE
+//____________________________________________________________________
+
+// wall clock in milliseconds
+static double sNow ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - FRAMEFEED
+//____________________________________________________________________
+FRAMEFEED::FRAMEFEED (
+    IDX     &idx,
+    unsigned size,
+    unsigned first,
+    unsigned count,
+    unsigned stride,
+    unsigned epochs,
+    unsigned ring)
+    : _idx(idx),_size(size),_first(first),_count(count),_stride(stride),
+      _epochs(epochs),_ring(ring),_quit(false),_running(false),_end(false),
+      _samples(0),_made(0),_tMake(0),_tFull(0),
+      _taken(0),_occupied(0),_peak(0),_tEmpty(0),_tStart(sNow())
+{
+    _running = pthread_create(&_thread, 0, Main, this) == 0;
+    _end = !_running;
+}
+
+FRAMEFEED::~FRAMEFEED ()
+{
+    if (_running) {
+        _quit = true;
+        pthread_join (_thread, 0);
+    }
+    FRAME f;
+    while (_ring.Pop(f)) {
+        IPOOL::Put(f._pad);
+    }
+}
+
+bool FRAMEFEED::Next (FRAME &f)
+{
+    if (_end) {
+        return false;
+    }
+    unsigned n = _ring.Count();
+    if (!_ring.Pop(f)) {
+        double t0 = sNow();
+        do {
+            sched_yield();
+        } while (!_ring.Pop(f));
+        _tEmpty += sNow() - t0;
+    }
+    if (!f._pad) {
+        _end = true;
+        return false;
+    }
+    _taken ++;
+    _occupied += n;
+    if (n > _peak) {
+        _peak = n;
+    }
+    return true;
+}
+
+void FRAMEFEED::Done (IPAD *pad)
+{
+    IPOOL::Put(pad);
+}
+
+// producer counters are complete once the end frame has been taken
+void FRAMEFEED::Report (ostream &out)
+{
+    double tAll = sNow() - _tStart;
+    out << "pipe: made " << _made << " frames of " << _samples
+        << " samples in " << _tMake << " ms ("
+        << (_tMake > 0 ? 1e3 * _made / _tMake : 0) << " frames/s), "
+        << _tFull << " ms waiting on a full ring" << endl;
+    out << "pipe: took " << _taken << " frames in " << tAll << " ms ("
+        << (tAll > 0 ? 1e3 * _taken / tAll : 0) << " frames/s), "
+        << _tEmpty << " ms waiting on an empty ring" << endl;
+    out << "pipe: ring " << (_taken ? (double)_occupied / _taken : 0)
+        << " of " << _ring.Capacity() << " frames on average, "
+        << _peak << " at most" << endl;
+}
+
+void * FRAMEFEED::Main (void *p)
+{
+    ((FRAMEFEED *)p)->Loop();
+    return 0;
+}
+
+// frames go in sample order, the movie of one sample after another;
+// each frame moves into a pooled pad (no copy) so the movie can go on
+void FRAMEFEED::Loop ()
+{
+    unsigned iRows = _idx.Dim(1);
+    unsigned iCols = _idx.Dim(2);
+    unsigned e, i;
+    FRAME f;
+    foreach (e,0,_epochs) {
+        IDXFEED feed (_idx, _first, _count, _stride);
+        while (!_quit && feed.Next(i)) {
+            double t0 = sNow();
+            IPAD datapad(iCols, iRows, _idx.Sample(i));
+            IPAD neupad (_size, _size);
+            neupad.Scale(datapad);
+            IMOV movie(neupad);
+            movie.Roll();
+            _samples ++;
+            f._sample = i;
+            f._first  = true;
+            IPAD *pad;
+            while ((pad = movie.Next()) != 0) {
+                f._pad = IPOOL::Get(_size, _size);
+                f._pad->Swap(*pad);
+                _made ++;
+                double t1 = sNow();
+                _tMake += t1 - t0;
+                while (!_ring.Push(f)) {
+                    if (_quit) {
+                        IPOOL::Put(f._pad);
+                        return;
+                    }
+                    sched_yield();
+                }
+                t0 = sNow();
+                _tFull += t0 - t1;
+                f._first = false;
+            }
+            _tMake += sNow() - t0;
+        }
+    }
+    f._pad    = 0;
+    f._sample = 0;
+    f._first  = false;
+    while (!_ring.Push(f) && !_quit) {
+        sched_yield();
+    }
+}
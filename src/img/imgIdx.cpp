@@ -0,0 +1,226 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : imgIdx.cpp
+//
+// DESCRIPTION :
+//    Reader of IDX files (the MNIST image and label sets), mapped
+//    into memory, and a feed of samples with a prefetch thread.
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ring.h"
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STATIC FUNCTIONS DEFINED IN THIS FILE
+//____________________________________________________________________
+
+// bytes per element of a data type; 0 if unknown
+static size_t sIdxElem (unsigned type)
+{
+    switch (type) {
+    case IDX::UBYTE:
+    case IDX::SBYTE:  return 1;
+    case IDX::SHORT:  return 2;
+    case IDX::INT:
+    case IDX::FLOAT:  return 4;
+    case IDX::DOUBLE: return 8;
+    default:          return 0;
+    }
+}
+
+// big-endian unsigned integer of n bytes
+static uint64_t sIdxWord (const unsigned char *p, size_t n)
+{
+    uint64_t u = 0;
+    size_t i;
+    foreach (i,0,n) {
+        u = (u << 8) | p[i];
+    }
+    return u;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - IDX
+//____________________________________________________________________
+bool IDX::Open (const char *chFileName)
+{
+    Close();
+    int fd = open (chFileName, O_RDONLY);
+    if (fd < 0) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be opened!" << endl;
+        return false;
+    }
+    struct stat st;
+    void *pMap = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= 4) {
+        // private pages: in-place edits of a view stay in memory
+        pMap = mmap (0, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close (fd);
+    if (pMap == MAP_FAILED) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be mapped!" << endl;
+        return false;
+    }
+    madvise (pMap, st.st_size, MADV_SEQUENTIAL);
+    _map  = pMap;
+    _size = st.st_size;
+
+    const unsigned char *p = (const unsigned char *)_map;
+    unsigned uDims = p[3];
+    _type = p[2];
+    _elem = sIdxElem(_type);
+    uint64_t uHead = 4 + 4*(uint64_t)uDims;
+    if (p[0] != 0 || p[1] != 0 || _elem == 0 || uDims == 0 ||
+        uHead > _size) {
+        cerr << "ERROR: file "<<chFileName<<" is not in IDX format!" << endl;
+        Close();
+        return false;
+    }
+    uint64_t uBytes = _elem;
+    unsigned d;
+    foreach (d,0,uDims) {
+        _dims.push_back((unsigned)sIdxWord(p+4+4*d, 4));
+        if (d > 0) {
+            uBytes *= _dims[d];
+        }
+        if (uBytes > _size) {
+            break;
+        }
+    }
+    _sample = (size_t)uBytes;
+    if (uBytes > _size || (uint64_t)_dims[0] * uBytes > _size - uHead) {
+        cerr << "ERROR: file "<<chFileName<<" is truncated!" << endl;
+        Close();
+        return false;
+    }
+    _data = (unsigned char *)_map + uHead;
+    return true;
+}
+
+void IDX::Close ()
+{
+    if (_map) {
+        munmap (_map, _size);
+    }
+    _map    = 0;
+    _size   = 0;
+    _data   = 0;
+    _type   = 0;
+    _elem   = 0;
+    _sample = 0;
+    _dims.clear();
+}
+
+double IDX::Value (unsigned i, size_t k)
+{
+    const unsigned char *p = Sample(i) + k*_elem;
+    uint64_t u = sIdxWord(p, _elem);
+    switch (_type) {
+    case SBYTE:  return (double)(signed char)u;
+    case SHORT:  return (double)(short)u;
+    case INT:    return (double)(int)u;
+    case FLOAT:  { uint32_t w=(uint32_t)u; float f;
+                   memcpy (&f, &w, sizeof(f)); return f; }
+    case DOUBLE: { double f; memcpy (&f, &u, sizeof(f)); return f; }
+    default:     return (double)u;
+    }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - IDXFEED
+//____________________________________________________________________
+IDXFEED::IDXFEED (
+    IDX     &idx,
+    unsigned first,
+    unsigned count,
+    unsigned stride,
+    unsigned ahead)
+    : _idx(idx),_first(first),_count(0),_stride(stride ? stride : 1),
+      _ahead(ahead ? ahead : 1),_pos(0),_quit(false),_running(false)
+{
+    if (first < idx.Count()) {
+        unsigned uMax = (idx.Count() - first - 1) / _stride + 1;
+        _count = (count == 0 || count > uMax) ? uMax : count;
+    }
+    pthread_mutex_init (&_mutex, 0);
+    pthread_cond_init  (&_moved, 0);
+    if (_count > 0) {
+        _running = pthread_create(&_thread, 0, Main, this) == 0;
+    }
+}
+
+IDXFEED::~IDXFEED ()
+{
+    if (_running) {
+        pthread_mutex_lock   (&_mutex);
+        _quit = true;
+        pthread_cond_signal  (&_moved);
+        pthread_mutex_unlock (&_mutex);
+        pthread_join (_thread, 0);
+    }
+    pthread_mutex_destroy (&_mutex);
+    pthread_cond_destroy  (&_moved);
+}
+
+bool IDXFEED::Next (unsigned &i)
+{
+    pthread_mutex_lock (&_mutex);
+    bool bMore = _pos < _count;
+    if (bMore) {
+        i = _first + _pos * _stride;
+        _pos ++;
+        pthread_cond_signal (&_moved);
+    }
+    pthread_mutex_unlock (&_mutex);
+    return bMore;
+}
+
+void * IDXFEED::Main (void *p)
+{
+    ((IDXFEED *)p)->Loop();
+    return 0;
+}
+
+// stay up to _ahead samples in front of the learner, touching one
+// byte per page of every sample
+void IDXFEED::Loop ()
+{
+    const long     lPage = sysconf(_SC_PAGESIZE);
+    const size_t   uPage = lPage > 0 ? (size_t)lPage : 4096;
+    const size_t   uBytes= _idx.Bytes();
+    unsigned       uDone = 0;     // samples faulted in
+    volatile unsigned char uSink = 0;
+    while (uDone < _count) {
+        pthread_mutex_lock (&_mutex);
+        while (!_quit && uDone >= _pos + _ahead) {
+            pthread_cond_wait (&_moved, &_mutex);
+        }
+        bool bQuit = _quit;
+        unsigned uEnd = _pos + _ahead;
+        pthread_mutex_unlock (&_mutex);
+        if (bQuit) {
+            break;
+        }
+        if (uEnd > _count) {
+            uEnd = _count;
+        }
+        for (; uDone < uEnd; uDone++) {
+            const unsigned char *p = _idx.Sample(_first + uDone*_stride);
+            size_t k;
+            for (k=0; k < uBytes; k += uPage) {
+                uSink += p[k];
+            }
+            if (uBytes) {
+                uSink += p[uBytes-1];
+            }
+        }
+    }
+}
@@ -6,100 +6,72 @@
 //
 
 
+#include <math.h>
 #include "ring.h"
 
-// - use uchar for a pixel.
-#include "img/imgRotate.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// STATIC DECLARATION
-//____________________________________________________________________
-
-
-//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// CLASS DECLARATION
+// CLASS FUNCTIONS - IPAD 
 //____________________________________________________________________
+IPAD::IPAD (IPAD &p) :
+    _width(p.width()),_height(p.height()),_size(_width*_height),_own(true)
+{
+    _data = new unsigned char [_size];
+    memcpy (_data, p._data, sizeof(unsigned char)*_size);
+}
 
-// RotateByShear: class for image rotation
-// Author: Eran Yariv
-// http://www.codeproject.com/KB/graphics/rotatebyshear.aspx
-//
-//      3-shear rotation by a specified angle is equivalent
-//      to the sequential transformations
-//        x' = x + tan(angle/2) * y      for first x-shear
-//        y' = y + sin(angle)   * x      for y-shear
-//        x' = x + tan(angle/2) * y      for second x-shear
-
-class RotateByShear : public CRotateByShear<COLORREF>
+// 64 pixels a word; with SSE2, 16 at a time by an unsigned compare
+// (max(p,t) == p) and a movemask
+const uint64_t * IPAD::Bits (unsigned char thresh)
 {
-public: 
-    RotateByShear (ProgressAnbAbortCallBack callback = NULL) : 
-        CRotateByShear<COLORREF> (callback) {}
-
-    virtual ~RotateByShear() {}
-
-    COLORREF GetRGB (COLORREF *pImage,  // Pointer to image
-                     SIZE  sImage,      // Size of image
-                     UINT  x,           // X coordinate
-                     UINT  y            // Y coordinate
-                    )
-    {
-        return pImage [x + y * sImage.cx];
-    }
-
-    // Set RGB value at given pixel coordinates
-    void SetRGB (COLORREF  *pImage,   // Pointer to image
-                 SIZE       sImage,   // Size of image
-                 UINT       x,        // X coordinate
-                 UINT       y,        // Y coordinate
-                 COLORREF   clr       // New color to set
-                )
-    {
-        pImage [x + y * sImage.cx] = clr;
-    }
-
-    // Create a new bitmap, given a bitmap dimensions
-    COLORREF *CreateNewBitmap (SIZE  sImage) // Size of image
-    {
-        return new COLORREF [sImage.cx * sImage.cy];
-    }
-
-    // Create a new bitmap which is an identical copy of the source bitmap
-    COLORREF *CopyBitmap (COLORREF *pImage,     // Pointer to source image
-                          SIZE      sImage      // Size of source (and destination) image
-                         )
-    {
-        COLORREF *pDst =  CreateNewBitmap (sImage);
-        if (NULL != pDst)
-        {
-            memcpy (pDst, pImage, sizeof (COLORREF) * sImage.cx * sImage.cy);
+    _bits.assign(Words(), 0);
+    if (_bits.empty()) {
+        return 0;
+    }
+    uint64_t *pBits = &_bits[0];
+    unsigned i=0;
+#ifdef __SSE2__
+    const __m128i vT = _mm_set1_epi8((char)thresh);
+    for (; i+16 <= _size; i+=16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(_data+i));
+        unsigned m = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_max_epu8(x, vT), x));
+        pBits[i/64] |= (uint64_t)m << (i%64);
+    }
+#endif
+    for (; i < _size; i++) {
+        if (_data[i] >= thresh) {
+            pBits[i/64] |= (uint64_t)1 << (i%64);
         }
-        return pDst;
-    }          
-
-    // Destroy a bitmap previously created in call to CreateNewBitmap(..)
-    // or to CopyBitmap (...)
-    void DestroyBitmap (COLORREF *pImage,   // Pointer to image
-                        SIZE                // Size of image
-                       )
-    {
-        delete [] pImage;
     }
-};
-
+    return pBits;
+}
 
-//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// CLASS FUNCTIONS - IPAD 
-//____________________________________________________________________
-IPAD::IPAD (IPAD &p) :
-    _width(p.width()),_height(p.height()),_size(_width*_height) 
+// the two binarized views XORed, two words at a time with SSE2
+const uint64_t * IPAD::Delta (IPAD &prev, unsigned char thresh)
 {
-    unsigned i;
-    _data = new unsigned char [_size];
-    foreach (i,0,_size) {
-        _data[i] = p._data[i];
+    if (prev.size() != _size || _size == 0) {
+        return 0;
+    }
+    const uint64_t *pPrev = prev.Bits(thresh);
+    Bits(thresh);
+    uint64_t *pBits = &_bits[0];
+    unsigned w=0, n=_bits.size();
+#ifdef __SSE2__
+    for (; w+2 <= n; w+=2) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(pBits+w));
+        __m128i y = _mm_loadu_si128((const __m128i *)(pPrev+w));
+        _mm_storeu_si128((__m128i *)(pBits+w), _mm_xor_si128(x, y));
+    }
+#endif
+    for (; w < n; w++) {
+        pBits[w] ^= pPrev[w];
     }
+    return pBits;
 }
 
 // scale up or down a given IPAD to its own size;
@@ -165,6 +137,8 @@ bool IPAD::Scale (IPAD &pad)
 //  2. integer scaling ratio
 bool IPAD::ScaleUp   (unsigned ratio)
 {
+    // not implemented
+    return false;
 }
 
 bool IPAD::ScaleDown (unsigned ratio)
@@ -184,6 +158,7 @@ bool IPAD::ScaleDown (unsigned ratio)
             }
         }
     }
+    return true;
 }
 
 // assumption for shifting : (0,0) is the upper-left corner
@@ -260,23 +235,26 @@ bool IPAD::ShiftDown(unsigned n)
     return true;
 }
 
-bool IPAD::Rotate (double dAngle)
+// into a pooled pad, then take its pixels
+bool IPAD::Rotate (double dAngle, ROTMAP::SAMPLE sample)
 {
-    RotateByShear rt;
-    SIZE   rsrc,rdst;
-    rsrc.cx = _width;
-    rsrc.cy = _height;
-    // generate rotated image (larger than original)
-    unsigned char *cdata;
-    cdata = rt.AllocAndRotate(_data, rsrc, dAngle, &rdst, 0);
-    // crop to original size
-    for (unsigned i=0; i<_width; ++i) {
-        for (unsigned j=0; j<_height; ++j) {
-            _data[index(i,j)] = 
-                cdata[indexcord(xcord(i),ycord(j),rdst.cx,rdst.cy)];
-        }
+    IPAD *dst = IPOOL::Get(_width, _height);
+    bool bOk = dst->Rotate(*this, dAngle, sample);
+    if (bOk && !Swap(*dst)) {
+        memcpy (_data, dst->_data, sizeof(unsigned char)*_size);
     }
-    delete [] cdata;
+    IPOOL::Put(dst);
+    return bOk;
+}
+
+bool IPAD::Rotate (IPAD &src, double dAngle, ROTMAP::SAMPLE sample)
+{
+    if (src.width() != _width || src.height() != _height ||
+        &src == this) {
+        return false;
+    }
+    ROTMAP::Get(_width, _height, dAngle, sample)->Apply(src._data, _data);
+    return true;
 }
 
 void IPAD::Clear ()
@@ -284,90 +262,265 @@ void IPAD::Clear ()
     memset(_data, 0, sizeof(unsigned char) * _size);
 }
 
+bool IPAD::Swap (IPAD &pad)
+{
+    if (pad._width != _width || pad._height != _height ||
+        !_own || !pad._own) {
+        return false;
+    }
+    unsigned char *pData = _data;
+    _data = pad._data;
+    pad._data = pData;
+    _bits.swap(pad._bits);
+    return true;
+}
+
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// CLASS FUNCTIONS - IMOV 
+// CLASS FUNCTIONS - IPOOL
 //____________________________________________________________________
 
-IMOV::IMOV (IPAD &p)
+static map<pair<unsigned,unsigned>,vector<IPAD*> > sPadPool;
+static pthread_mutex_t sPadMutex = PTHREAD_MUTEX_INITIALIZER;
+
+IPAD * IPOOL::Get (unsigned w, unsigned h)
 {
-    _ipads.push_back(new IPAD(p));
+    IPAD *pad = 0;
+    pthread_mutex_lock (&sPadMutex);
+    vector<IPAD*> &vFree = sPadPool[make_pair(w,h)];
+    if (!vFree.empty()) {
+        pad = vFree.back();
+        vFree.pop_back();
+    }
+    pthread_mutex_unlock (&sPadMutex);
+    return pad ? pad : new IPAD(w, h);
 }
 
-IMOV::~IMOV ()
+void IPOOL::Put (IPAD *pad)
 {
-    vector<IPAD*>::iterator it;
-    foreachv (it,_ipads) {
-        delete (*it);
+    if (!pad) {
+        return;
     }
+    pthread_mutex_lock (&sPadMutex);
+    sPadPool[make_pair(pad->width(),pad->height())].push_back(pad);
+    pthread_mutex_unlock (&sPadMutex);
 }
 
 
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - ROTMAP
+//____________________________________________________________________
+
+// tables by (width, height, angle, sampling); never freed, there are
+// only a handful (IMOV::Roll uses 4 angles on 2 pad sizes)
+typedef pair<pair<unsigned,unsigned>,pair<double,int> > ROTKEY;
+static map<ROTKEY,ROTMAP*> sRotMaps;
+static pthread_mutex_t     sRotMutex = PTHREAD_MUTEX_INITIALIZER;
+
+const ROTMAP * ROTMAP::Get (
+    unsigned w,
+    unsigned h,
+    double   angle,
+    SAMPLE   s)
+{
+    ROTKEY key (make_pair(w,h), make_pair(angle,(int)s));
+    pthread_mutex_lock (&sRotMutex);
+    map<ROTKEY,ROTMAP*>::iterator it = sRotMaps.find(key);
+    ROTMAP *pMap;
+    if (it == sRotMaps.end()) {
+        pMap = new ROTMAP(w, h, angle, s);
+        sRotMaps[key] = pMap;
+    } else {
+        pMap = (*it).second;
+    }
+    pthread_mutex_unlock (&sRotMutex);
+    return pMap;
+}
+
+// inverse mapping: pixel (i,j) reads the source at (i,j) turned back
+// by the angle about the centre; outside the pad is background (0)
+ROTMAP::ROTMAP (unsigned w, unsigned h, double angle, SAMPLE s)
+    : _size(w*h),_taps(s == NEAREST ? 1 : 4)
+{
+    _src.assign(_size*_taps, 0);
+    _wt .assign(_size*_taps, 0);
+    double dRad = angle * M_PI / 180.0;
+    double dCos = cos(dRad), dSin = sin(dRad);
+    double cx = (w - 1) / 2.0, cy = (h - 1) / 2.0;
+    unsigned i, j;
+    foreach (j,0,h) {
+        foreach (i,0,w) {
+            double x  = i - cx, y = j - cy;
+            double sx = dCos*x - dSin*y + cx;
+            double sy = dSin*x + dCos*y + cy;
+            unsigned k = (j*w + i) * _taps;
+            if (s == NEAREST) {
+                int xi = (int)floor(sx + 0.5), yi = (int)floor(sy + 0.5);
+                if (xi >= 0 && xi < (int)w && yi >= 0 && yi < (int)h) {
+                    _src[k] = yi*w + xi;
+                    _wt [k] = 1;
+                }
+                continue;
+            }
+            int    x0 = (int)floor(sx), y0 = (int)floor(sy);
+            // 7-bit fractions; the 4 weights add up to 1<<14
+            unsigned fx = (unsigned)floor((sx - x0) * 128.0 + 0.5);
+            unsigned fy = (unsigned)floor((sy - y0) * 128.0 + 0.5);
+            unsigned t;
+            foreach (t,0,4) {
+                int xt = x0 + (t & 1), yt = y0 + (t >> 1);
+                unsigned wx = (t & 1)  ? fx : 128 - fx;
+                unsigned wy = (t >> 1) ? fy : 128 - fy;
+                if (xt >= 0 && xt < (int)w && yt >= 0 && yt < (int)h) {
+                    _src[k+t] = yt*w + xt;
+                    _wt [k+t] = wx * wy;
+                }
+            }
+        }
+    }
+}
+
+void ROTMAP::Apply (const unsigned char *src, unsigned char *dst) const
+{
+    const unsigned       *pSrc = &_src[0];
+    const unsigned short *pWt  = &_wt[0];
+    unsigned i;
+    if (_taps == 1) {
+        foreach (i,0,_size) {
+            dst[i] = pWt[i] ? src[pSrc[i]] : 0;
+        }
+        return;
+    }
+    foreach (i,0,_size) {
+        unsigned v = pWt[0]*src[pSrc[0]] + pWt[1]*src[pSrc[1]] +
+                     pWt[2]*src[pSrc[2]] + pWt[3]*src[pSrc[3]];
+        dst[i] = (unsigned char)((v + (1 << 13)) >> 14);
+        pSrc += 4;
+        pWt  += 4;
+    }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - IMOV 
+//____________________________________________________________________
+
+IMOV::IMOV (IPAD &p) :
+    _pad(p),_next(0),_frames(0),_base(0),_reduce(0)
+{
+    _frame[0] = IPOOL::Get(_pad.width(), _pad.height());
+    _frame[1] = IPOOL::Get(_pad.width(), _pad.height());
+}
+
+IMOV::~IMOV ()
+{
+    IPOOL::Put(_frame[0]);
+    IPOOL::Put(_frame[1]);
+    IPOOL::Put(_base);
+}
+
 bool IMOV::AddIpad(
-    IPAD   * p, 
-    MTYPE    type, // type of move
-    unsigned a)    // quantity of move
+    MTYPE    type,   // type of move
+    unsigned a,      // quantity of move
+    unsigned reduce) // of the pad the move starts from
+{
+    STEP step;
+    step.type   = type;
+    step.amount = a;
+    step.reduce = reduce;
+    _steps.push_back(step);
+    return true;
+}
+
+// the pad scaled down by reduce, made once for a run of moves
+IPAD * IMOV::Base (unsigned reduce)
 {
-    bool bOk=true;
-    IPAD *pad = new IPAD(*p);
-    if (a != 0) {
-        switch (type) {
-        case ROTATE :
-            bOk=pad->Rotate((double)a); break;
-        case SHIFTU :
-            bOk=pad->ShiftUp   (a); break;
-        case SHIFTD :
-            bOk=pad->ShiftDown (a); break;
-        case SHIFTL :
-            bOk=pad->ShiftLeft (a); break;
-        case SHIFTR :
-            bOk=pad->ShiftRight(a); break;
-        case SCALED :
-            bOk=pad->ScaleDown (a); break;
-        case NONE :
-        default: break;
+    if (reduce == 1) {
+        return &_pad;
+    }
+    if (!_base || _reduce != reduce) {
+        if (!_base) {
+            _base = IPOOL::Get(_pad.width(), _pad.height());
         }
+        memcpy (_base->Data(), _pad.Data(), _pad.size());
+        _base->ScaleDown(reduce);
+        _reduce = reduce;
     }
-    pad->WriteGif();
-    if (bOk) {
-        _ipads.push_back(pad);
-    } else {
-        delete pad;
+    return _base;
+}
+
+// moves that fail make no frame
+IPAD * IMOV::Next ()
+{
+    IPAD *pad = _frame[1];
+    _frame[1] = _frame[0];
+    _frame[0] = pad;
+    while (_next < _steps.size()) {
+        const STEP &step = _steps[_next++];
+        bool bOk=true;
+        unsigned a = step.amount;
+        if (step.reduce == 0) {
+            // every move keeps a blank pad blank
+            pad->Clear();
+        } else if (step.type == ROTATE && a != 0) {
+            // the table writes every pixel, no copy needed
+            bOk = pad->Rotate(*Base(step.reduce), (double)a);
+        } else {
+            memcpy (pad->Data(), Base(step.reduce)->Data(), pad->size());
+            if (a != 0) {
+                switch (step.type) {
+                case SHIFTU :
+                    bOk=pad->ShiftUp   (a); break;
+                case SHIFTD :
+                    bOk=pad->ShiftDown (a); break;
+                case SHIFTL :
+                    bOk=pad->ShiftLeft (a); break;
+                case SHIFTR :
+                    bOk=pad->ShiftRight(a); break;
+                case SCALED :
+                    bOk=pad->ScaleDown (a); break;
+                case ROTATE :
+                case NONE :
+                default: break;
+                }
+            }
+        }
+        GIFSINK::Put(*pad);
+        if (bOk) {
+            _frames ++;
+            return pad;
+        }
     }
-    return bOk;
+    return 0;
 }
 
 // expand the ipad into a movie by a sequence of moves
 // e.g. shifting, scaling, rotating
 bool IMOV::Roll ()
 {
-    IPAD *pado = _ipads.front();
-    _ipads.pop_back();
+    _steps.clear();
+    Rewind();
     // rotate from left to right at 15 degree interval
-    AddIpad (pado, ROTATE,  30);
-    AddIpad (pado, ROTATE,  15);
-    AddIpad (pado, ROTATE,   0);
-    AddIpad (pado, ROTATE, 345);
-    AddIpad (pado, ROTATE, 330);
-    IPAD padn (*pado);
-    delete pado;
+    AddIpad (ROTATE,  30);
+    AddIpad (ROTATE,  15);
+    AddIpad (ROTATE,   0);
+    AddIpad (ROTATE, 345);
+    AddIpad (ROTATE, 330);
     // scale down and shift 4 times
-    padn.ScaleDown(2);
-    AddIpad (&padn, NONE,     0);
-    AddIpad (&padn, SHIFTL,   3);
-    AddIpad (&padn, SHIFTU,   3);
-    AddIpad (&padn, SHIFTR,   3);
-    AddIpad (&padn, SHIFTD,   3);
+    AddIpad (NONE,     0, 2);
+    AddIpad (SHIFTL,   3, 2);
+    AddIpad (SHIFTU,   3, 2);
+    AddIpad (SHIFTR,   3, 2);
+    AddIpad (SHIFTD,   3, 2);
     // rotate from left to right at 15 degree interval
-    AddIpad (&padn, ROTATE,  30);
-    AddIpad (&padn, ROTATE,  15);
-    AddIpad (&padn, ROTATE,   0);
-    AddIpad (&padn, ROTATE, 345);
-    AddIpad (&padn, ROTATE, 330);
+    AddIpad (ROTATE,  30, 2);
+    AddIpad (ROTATE,  15, 2);
+    AddIpad (ROTATE,   0, 2);
+    AddIpad (ROTATE, 345, 2);
+    AddIpad (ROTATE, 330, 2);
     // bland pad for 5 frames
-    padn.Clear();
     for (unsigned i=0; i<5; ++i) {
-        AddIpad (&padn, NONE, 0);
+        AddIpad (NONE, 0, 0);
     }
+    return true;
 }
-
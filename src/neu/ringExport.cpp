@@ -7,10 +7,12 @@
 // DESCRIPTION :
 //    Export the neuron network in various formats.
 //    Currently supported : GIF, DOT.
+//    Training frames go out as GIF through GIFSINK.
 
 
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "ring.h"
 #include "gif/gifsave.h"
 
@@ -89,6 +91,81 @@ void IPAD::WriteGif()
 }
 
 
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - GIFSINK
+//____________________________________________________________________
+static unsigned      sSinkEvery   = 0;
+static unsigned      sSinkFrames  = 0;     // frames seen
+static unsigned      sSinkDropped = 0;
+static SPSC<IPAD*>   sSinkRing (1024);
+static volatile bool sSinkQuit    = false;
+static bool          sSinkRunning = false;
+static pthread_t     sSinkThread;
+
+// the encoder; polls the ring, a debug aid need not be prompt
+static void * sSinkMain (void *)
+{
+    IPAD *pad;
+    bool bQuit = false;
+    while (true) {
+        if (sSinkRing.Pop(pad)) {
+            pad->WriteGif();
+            IPOOL::Put(pad);
+        } else if (bQuit) {
+            break;
+        } else {
+            // once told to quit, look once more for the last frames
+            bQuit = sSinkQuit;
+            if (!bQuit) {
+                usleep (1000);
+            }
+        }
+    }
+    return 0;
+}
+
+void GIFSINK::Every (unsigned n)
+{
+    sSinkEvery  = n;
+    sSinkFrames = 0;
+}
+
+void GIFSINK::Put (IPAD &pad)
+{
+    if (sSinkEvery == 0 || (sSinkFrames++ % sSinkEvery) != 0) {
+        return;
+    }
+    if (!sSinkRunning) {
+        sSinkQuit    = false;
+        sSinkRunning = pthread_create(&sSinkThread, 0, sSinkMain, 0) == 0;
+        if (!sSinkRunning) {
+            pad.WriteGif();
+            return;
+        }
+    }
+    IPAD *copy = IPOOL::Get(pad.width(), pad.height());
+    memcpy (copy->Data(), pad.Data(), pad.size());
+    if (!sSinkRing.Push(copy)) {
+        IPOOL::Put(copy);
+        sSinkDropped ++;
+    }
+}
+
+void GIFSINK::Close ()
+{
+    if (sSinkRunning) {
+        sSinkQuit = true;
+        pthread_join (sSinkThread, 0);
+        sSinkRunning = false;
+    }
+    if (sSinkDropped) {
+        cerr << "gif: " << sSinkDropped
+             << " frames dropped, the encoder fell behind" << endl;
+        sSinkDropped = 0;
+    }
+}
+
+
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // Writing ATT DOT format
 //____________________________________________________________________
@@ -240,18 +317,18 @@ void NET::WriteDot ()
         for ( iN = vLevels->at(nLevels-Level-1);
               iN != NEURON::NONE; iN = Get(iN).Next()) {
             
-            map<NID,SYNAP>& mL=Get(iN).Links();
-            map<NID,SYNAP>::iterator it;
+            LINKS& mL=Get(iN).Links();
+            LINKS::iterator it;
             foreachv (it, mL) {
-                NID iN2 = (*it).first;
+                NID iN2 = (*it).Nid();
                 // generate the edge from inputs to this node
                 pFile << "Node" << iN;
                 pFile << " -> ";
                 pFile << "Node" << iN2;
                 pFile << " [style = ";
-                pFile << (((*it).second.Weight()>1) ? "bold" : "dashed");
+                pFile << (((*it).Syn().Weight()>1) ? "bold" : "dashed");
                 pFile << ", color = ";
-                pFile << (((*it).second.Delayed()) ? "blue" : "grey");
+                pFile << (((*it).Syn().Delayed()) ? "blue" : "grey");
                 pFile << "];" << endl;
             }
         }
@@ -0,0 +1,480 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : ringInfer.cpp
+//
+// DESCRIPTION :
+//    Recognition on a trained NET, without any of the learning
+//    machinery (Connect, BBS, undo log, cooling).
+//
+//    One query is a single propagation pass over the immediate links,
+//    wave by wave as in real firing: the input pixels that are on
+//    excite their input neurons; each firing neuron splits its
+//    potential among its links by weight; a neuron that turns HYPER
+//    fires in the next wave if the sources that reached it in this
+//    wave are exactly its signature, the test BBS::Select applies in
+//    training; as there, among the neurons reached by the same set of
+//    sources only the one with the highest potential fires.  Delayed
+//    links and the delayed part of signatures take part in learning
+//    across ticks only, and are left out.  No neuron fires twice.
+//    Output neurons reaching HYPER are the answer.
+//
+//    A batch runs the same pass for 64 images at once: each neuron
+//    holds a word of lanes, one bit per image, for firing, reach and
+//    miss, and its potential as 8 bit planes, so that one link adds
+//    its share to all the lanes its source fires in with a few word
+//    operations.  Only the competition is decided lane by lane.
+
+#include <string.h>
+#include <algorithm>
+#include "ring.h"
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STATIC FUNCTIONS DEFINED IN THIS FILE
+//____________________________________________________________________
+
+// bit planes of a potential (it saturates at 255)
+static const unsigned sPlanes = 8;
+
+// add c to the lanes m of a potential, saturating
+static void sLaneAdd (uint64_t *p, unsigned c, uint64_t m)
+{
+    uint64_t carry = 0;
+    unsigned b;
+    foreach (b,0,sPlanes) {
+        uint64_t x = ((c >> b) & 1) ? m : 0;
+        uint64_t s = p[b] ^ x;
+        uint64_t o = (p[b] & x) | (carry & s);
+        p[b]  = s ^ carry;
+        carry = o;
+    }
+    if (carry) {
+        foreach (b,0,sPlanes) { p[b] |= carry; }
+    }
+}
+
+// lanes whose potential is greater than c
+static uint64_t sLaneGreater (const uint64_t *p, unsigned c)
+{
+    uint64_t gt = 0, eq = ~(uint64_t)0;
+    unsigned b = sPlanes;
+    while (b-- > 0) {
+        if ((c >> b) & 1) {
+            eq &= p[b];
+        } else {
+            gt |= eq & p[b];
+            eq &= ~p[b];
+        }
+    }
+    return gt;
+}
+
+// lanes whose potential is c
+static uint64_t sLaneEqual (const uint64_t *p, unsigned c)
+{
+    uint64_t eq = ~(uint64_t)0;
+    unsigned b;
+    foreach (b,0,sPlanes) {
+        eq &= ((c >> b) & 1) ? p[b] : ~p[b];
+    }
+    return eq;
+}
+
+// potential in one lane
+static unsigned sLaneValue (const uint64_t *p, unsigned lane)
+{
+    unsigned v = 0, b;
+    foreach (b,0,sPlanes) {
+        v |= (unsigned)((p[b] >> lane) & 1) << b;
+    }
+    return v;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS NET  MEMBER FUNCTIONS
+//____________________________________________________________________
+
+// take the read-only view of the current links and signatures
+void NET::Freeze ()
+{
+    if (!_frozen) {
+        _frozen = new FROZEN;
+    }
+    FROZEN &f = *_frozen;
+    f._off.assign(TSIZE+1, 0);
+    f._total.assign(TSIZE, 0);
+    f._inOff.assign(TSIZE+1, 0);
+    f._signOff.assign(TSIZE+1, 0);
+    f._dst.clear();
+    f._weight.clear();
+    f._inSign.clear();
+    f._sign.clear();
+    NID i;
+    // signatures first, for the per-link test below
+    foreach (i,0,TSIZE) {
+        // keys are (source << 1 | delayed), so sources come sorted
+        f._signOff[i] = f._sign.size();
+        NEURON neu = Neu(i);
+        const unsigned *pKey = neu.Sign().Keys();
+        unsigned k;
+        foreach (k,0,neu.Sign().NumKeys()) {
+            if (!(pKey[k] & 1)) {
+                f._sign.push_back(pKey[k] >> 1);
+            }
+        }
+    }
+    f._signOff[TSIZE] = f._sign.size();
+    vector<unsigned> vLinked(TSIZE, 0);   // sign sources with a link
+    foreach (i,0,TSIZE) {
+        NEURON neu = Neu(i);
+        LINKS::iterator it;
+        f._off[i] = f._dst.size();
+        foreachv (it, neu.Links()) {
+            if (!(*it).Syn().Delayed()) {
+                NID dst = (*it).Nid();
+                vector<NID>::iterator itBeg = f._sign.begin();
+                bool bIn = binary_search(itBeg + f._signOff[dst],
+                                         itBeg + f._signOff[dst+1], i);
+                f._dst   .push_back(dst);
+                f._weight.push_back((*it).Syn().Weight());
+                f._inSign.push_back(bIn);
+                f._total[i] += (*it).Syn().Weight();
+                f._inOff[dst+1] ++;
+                vLinked[dst] += bIn;
+            }
+        }
+    }
+    f._off[TSIZE] = f._dst.size();
+    // links into each target, sources ascending
+    foreach (i,0,TSIZE) {
+        f._inOff[i+1] += f._inOff[i];
+    }
+    f._src.resize(f._dst.size());
+    vector<unsigned> vPos(f._inOff.begin(), f._inOff.end()-1);
+    foreach (i,0,TSIZE) {
+        unsigned k;
+        foreach (k,f._off[i],f._off[i+1]) {
+            f._src[vPos[f._dst[k]]++] = i;
+        }
+    }
+    // a neuron without a signature, or without links, takes any
+    // pattern; one whose signature lost an immediate link takes none
+    f._match.assign(TSIZE, FROZEN::SIGN);
+    foreach (i,0,TSIZE) {
+        unsigned uSign = f._signOff[i+1] - f._signOff[i];
+        if (uSign == 0 || Neu(i).LinkCount() == 0) {
+            f._match[i] = FROZEN::ANY;
+        } else if (vLinked[i] < uSign) {
+            f._match[i] = FROZEN::NEVER;
+        }
+    }
+    f._potent.assign(TSIZE, 0);
+    f._hits  .assign(TSIZE, 0);
+    f._miss  .assign(TSIZE, 0);
+    f._fired .assign(TSIZE, 0);
+    f._pattern.assign(TSIZE, 0);
+    f._bPotent.assign(TSIZE*sPlanes, 0);
+    f._bFired .assign(TSIZE, 0);
+    f._bFire  .assign(TSIZE, 0);
+    f._bSpread.assign(TSIZE, 0);
+    f._bReach .assign(TSIZE, 0);
+    f._bMiss  .assign(TSIZE, 0);
+}
+
+const vector<NID> & NET::Infer (IPAD &ipad)
+{
+    if (!_frozen) {
+        Freeze();
+    }
+    FROZEN &f = *_frozen;
+    unsigned *pPotent  = &f._potent[0];
+    unsigned *pHits    = &f._hits[0];
+    char     *pMiss    = &f._miss[0];
+    uint64_t *pPattern = &f._pattern[0];
+    f._outputs.clear();
+    f._wave.clear();
+    // input neurons of the pixels that are on, as NET::Input(IPAD&)
+    const uint64_t *pBits = ipad.Bits(_threshold);
+    NID uSize = ipad.size() < ISIZE ? ipad.size() : ISIZE;
+    NID i;
+    foreach (i,0,uSize) {
+        if ((pBits[i/64] >> (i%64)) & 1) {
+            f._potent[i] = NEURON::EXCITE_HIGH;
+            f._fired [i] = 1;
+            f._touched.push_back(i);
+            f._wave.push_back(i);
+        }
+    }
+    while (!f._wave.empty()) {
+        vector<NID>::iterator it;
+        // the whole wave fires at once, with the potential it had
+        f._energy.clear();
+        foreachv (it, f._wave) {
+            f._energy.push_back(f._potent[*it]);
+        }
+        // spread the potential of the wave
+        unsigned w;
+        foreach (w,0,f._wave.size()) {
+            NID src = f._wave[w];
+            unsigned uEnergy = f._energy[w];
+            unsigned uBeg = f._off[src];
+            unsigned n    = f._off[src+1] - uBeg;
+            if (uEnergy <= (unsigned)NEURON::THRESH_HIGH || n == 0) {
+                continue;
+            }
+            f._share.resize(n);
+            ENERGY::Split (uEnergy, f._total[src], &f._weight[uBeg],
+                           &f._share[0], n);
+            const NID      *pDst   = &f._dst[uBeg];
+            const char     *pIn    = &f._inSign[uBeg];
+            const unsigned *pShare = &f._share[0];
+            uint64_t        uPat   = RNG::Mix(src);
+            unsigned k;
+            foreach (k,0,n) {
+                NID dst = pDst[k];
+                if (pHits[dst] == 0 && !pMiss[dst]) {
+                    // first link to dst in this wave
+                    f._cand   .push_back(dst);
+                    f._touched.push_back(dst);
+                }
+                unsigned u = pPotent[dst] + pShare[k];
+                pPotent[dst] = u > 255 ? 255 : u;
+                pPattern[dst] += uPat;
+                if (pIn[k]) {
+                    pHits[dst]++;
+                } else {
+                    pMiss[dst] = 1;
+                }
+            }
+        }
+        // candidates that match, competing per firing pattern
+        f._pick.clear();
+        foreachv (it, f._cand) {
+            NID dst = *it;
+            unsigned uSign = f._signOff[dst+1] - f._signOff[dst];
+            bool bMatch = f._match[dst] == FROZEN::ANY ||
+                          (!f._miss[dst] && f._hits[dst] == uSign);
+            if (f._potent[dst] > (unsigned)NEURON::THRESH_BASE &&
+                !f._fired[dst] && bMatch) {
+                FROZEN::PICK p = { 0, f._pattern[dst], f._potent[dst], dst };
+                f._pick.push_back(p);
+            }
+            f._hits   [dst] = 0;
+            f._miss   [dst] = 0;
+            f._pattern[dst] = 0;
+        }
+        sort (f._pick.begin(), f._pick.end());
+        // winners fire in the next wave, in ascending order
+        f._next.clear();
+        unsigned k;
+        foreach (k,0,f._pick.size()) {
+            if (k > 0 && f._pick[k]._pattern == f._pick[k-1]._pattern) {
+                continue;
+            }
+            NID dst = f._pick[k]._nid;
+            f._fired[dst] = 1;
+            if (Neu(dst).Type() == OUTPUT) {
+                f._outputs.push_back(dst);
+            } else {
+                f._next.push_back(dst);
+            }
+        }
+        sort (f._next.begin(), f._next.end());
+        f._cand.clear();
+        f._wave.swap(f._next);
+    }
+    vector<NID>::iterator it;
+    foreachv (it, f._touched) {
+        f._potent[*it] = 0;
+        f._fired [*it] = 0;
+    }
+    f._touched.clear();
+    sort (f._outputs.begin(), f._outputs.end());
+    return f._outputs;
+}
+
+// outputs of each image, as Infer(IPAD&) gives them
+void NET::Infer (
+    const vector<IPAD *>   &vPads,
+    vector< vector<NID> >  &vOutputs)
+{
+    if (!_frozen) {
+        Freeze();
+    }
+    vOutputs.resize(vPads.size());
+    unsigned uBeg;
+    for (uBeg=0; uBeg < vPads.size(); uBeg += 64) {
+        unsigned n = vPads.size() - uBeg;
+        InferLanes (&vPads[uBeg], n < 64 ? n : 64, &vOutputs[uBeg]);
+    }
+}
+
+void NET::InferLanes (
+    IPAD *const *ppPad,
+    unsigned     uLanes,
+    vector<NID> *pOutputs)
+{
+    FROZEN &f = *_frozen;
+    uint64_t *pPotent = &f._bPotent[0];
+    uint64_t *pFired  = &f._bFired [0];
+    uint64_t *pFire   = &f._bFire  [0];
+    uint64_t *pSpread = &f._bSpread[0];
+    uint64_t *pReach  = &f._bReach [0];
+    uint64_t *pMiss   = &f._bMiss  [0];
+    unsigned  l;
+    foreach (l,0,uLanes) {
+        pOutputs[l].clear();
+    }
+    // input neurons of the set pixels, lane by lane
+    f._wave.clear();
+    NID i;
+    foreach (l,0,uLanes) {
+        IPAD &ipad = *ppPad[l];
+        const uint64_t *pBits = ipad.Bits(_threshold);
+        NID uSize = ipad.size() < ISIZE ? ipad.size() : ISIZE;
+        foreach (i,0,uSize) {
+            pFire[i] |= ((pBits[i/64] >> (i%64)) & 1) << l;
+        }
+    }
+    foreach (i,0,ISIZE) {
+        if (pFire[i]) {
+            sLaneAdd (pPotent + i*sPlanes, NEURON::EXCITE_HIGH, pFire[i]);
+            pFired[i] = pFire[i];
+            f._wave   .push_back(i);
+            f._touched.push_back(i);
+        }
+    }
+    while (!f._wave.empty()) {
+        vector<NID>::iterator it;
+        // the whole wave fires at once: sources by energy and lanes
+        f._burst.clear();
+        foreachv (it, f._wave) {
+            NID src = *it;
+            uint64_t m = pFire[src];
+            pFire[src] = 0;
+            if (f._off[src+1] == f._off[src]) {
+                continue;
+            }
+            const uint64_t *p = pPotent + src*sPlanes;
+            m &= sLaneGreater (p, NEURON::THRESH_HIGH);
+            while (m) {
+                unsigned v = sLaneValue (p, __builtin_ctzll(m));
+                FROZEN::BURST b = { src, v, m & sLaneEqual(p, v) };
+                f._burst.push_back(b);
+                m &= ~b._lanes;
+            }
+        }
+        // spread the potential of the wave
+        vector<FROZEN::BURST>::iterator bt;
+        foreachv (bt, f._burst) {
+            NID      src   = (*bt)._src;
+            uint64_t m     = (*bt)._lanes;
+            unsigned uBeg  = f._off[src];
+            unsigned n     = f._off[src+1] - uBeg;
+            f._share.resize(n);
+            ENERGY::Split ((*bt)._energy, f._total[src], &f._weight[uBeg],
+                           &f._share[0], n);
+            pSpread[src] |= m;
+            const NID      *pDst   = &f._dst[uBeg];
+            const char     *pIn    = &f._inSign[uBeg];
+            const unsigned *pShare = &f._share[0];
+            unsigned k;
+            foreach (k,0,n) {
+                NID dst = pDst[k];
+                if (pReach[dst] == 0) {
+                    f._cand   .push_back(dst);
+                    f._touched.push_back(dst);
+                }
+                pReach[dst] |= m;
+                if (!pIn[k]) {
+                    pMiss[dst] |= m;
+                }
+                if (pShare[k]) {
+                    sLaneAdd (pPotent + dst*sPlanes, pShare[k], m);
+                }
+            }
+        }
+        // candidates that match, competing per lane and firing pattern
+        f._pick.clear();
+        foreachv (it, f._cand) {
+            NID dst = *it;
+            uint64_t m = pReach[dst] & ~pFired[dst] &
+                sLaneGreater (pPotent + dst*sPlanes, NEURON::THRESH_BASE);
+            if (f._match[dst] == FROZEN::NEVER) {
+                m = 0;
+            } else if (f._match[dst] == FROZEN::SIGN) {
+                m &= ~pMiss[dst];
+                unsigned k;
+                foreach (k,f._signOff[dst],f._signOff[dst+1]) {
+                    m &= pSpread[f._sign[k]];
+                }
+            }
+            if (m) {
+                // the pattern of each lane, from the sources in it
+                uint64_t uPat[64];
+                memset (uPat, 0, sizeof(uPat));
+                unsigned k;
+                foreach (k,f._inOff[dst],f._inOff[dst+1]) {
+                    NID src = f._src[k];
+                    uint64_t w = pSpread[src] & m;
+                    uint64_t h = RNG::Mix(src);
+                    while (w) {
+                        uPat[__builtin_ctzll(w)] += h;
+                        w &= w - 1;
+                    }
+                }
+                while (m) {
+                    unsigned lane = __builtin_ctzll(m);
+                    FROZEN::PICK p = { lane, uPat[lane],
+                        sLaneValue(pPotent + dst*sPlanes, lane), dst };
+                    f._pick.push_back(p);
+                    m &= m - 1;
+                }
+            }
+        }
+        foreachv (it, f._cand) {
+            pReach[*it] = 0;
+            pMiss [*it] = 0;
+        }
+        foreachv (bt, f._burst) {
+            pSpread[(*bt)._src] = 0;
+        }
+        f._cand.clear();
+        sort (f._pick.begin(), f._pick.end());
+        // winners fire in the next wave
+        f._next.clear();
+        unsigned k;
+        foreach (k,0,f._pick.size()) {
+            FROZEN::PICK &p = f._pick[k];
+            if (k > 0 && p._lane    == f._pick[k-1]._lane &&
+                         p._pattern == f._pick[k-1]._pattern) {
+                continue;
+            }
+            uint64_t bit = (uint64_t)1 << p._lane;
+            pFired[p._nid] |= bit;
+            if (Neu(p._nid).Type() == OUTPUT) {
+                pOutputs[p._lane].push_back(p._nid);
+            } else {
+                if (pFire[p._nid] == 0) {
+                    f._next.push_back(p._nid);
+                }
+                pFire[p._nid] |= bit;
+            }
+        }
+        sort (f._next.begin(), f._next.end());
+        f._wave.swap(f._next);
+    }
+    // the rest of the scratch is back to zero after each wave
+    vector<NID>::iterator it;
+    foreachv (it, f._touched) {
+        memset (pPotent + *it*sPlanes, 0, sPlanes*sizeof(uint64_t));
+        pFired[*it] = 0;
+    }
+    f._touched.clear();
+    foreach (l,0,uLanes) {
+        sort (pOutputs[l].begin(), pOutputs[l].end());
+    }
+}
@@ -0,0 +1,663 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : ringJournal.cpp
+//
+// DESCRIPTION :
+//    Write-ahead log of the changes between snapshots (JOURNAL),
+//    and its replay on top of a loaded snapshot.
+//
+//    File layout (little-endian, version 3):
+//      header   magic "RINGJRNL", version, 0, time and fingerprint
+//               of the base state
+//      records  one op byte (op in the low 3 bits, delayed flag in
+//               bit 3) followed by unsigned LEB128 varints:
+//        J_LINK, J_WEAKEN, J_DEACTIVE, J_REMOVE   src, dst
+//        J_ASSIGN   nid, key count, keys (first, then differences)
+//        J_AGE      src, dst, age
+//        J_TICK     time, next output, rng count; then each neuron
+//                   whose potential, state or flags changed since
+//                   the last tick, as NID difference + 1, potential,
+//                   state, flags, with 0 ending the list; then the
+//                   five firing queues (prio, curr, wave front, wave
+//                   back, bake) as length and NIDs
+//
+//    Records name the NEURON call that made the change rather than
+//    its outcome; replayed on the same state, each call takes the
+//    same branch again.  Aging is too frequent to log per call, and
+//    none of these calls looks at the age; instead each Update ends
+//    with the final age of every link of the neurons that fired.
+//    The age breaks ties between firing patterns (BBS::Compare).
+//
+//    Activity is logged as of the end of each Update, against a copy
+//    of what the last tick wrote; it is few neurons, but they are
+//    found by a sweep, since too many places excite and cool them.
+//    A replay thus rebuilds the whole state of the last complete
+//    Update, as a snapshot taken then would hold it, and training
+//    goes on as if it had not stopped.
+//
+//    A checkpoint cycle is NET::Save followed by NET::Journal, which
+//    starts a fresh log on top of the saved state.  The header names
+//    that state by NET::Fingerprint, so a log is replayed only on the
+//    state it was made on.
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "ring.h"
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// JOURNAL FORMAT
+//____________________________________________________________________
+static const char     chJrnlMagic[8] = {'R','I','N','G','J','R','N','L'};
+static const uint32_t uJrnlVersion   = 3;
+static const unsigned uJrnlQueues    = 5;
+
+struct JRNLHEAD
+{
+    char     _magic[8];
+    uint32_t _version;
+    uint32_t _pad;
+    int64_t  _time;
+    uint64_t _base;     // NET::Fingerprint of the base state
+};
+
+// one decoded record
+struct JRNLREC
+{
+    unsigned _op;
+    bool     _delayed;
+    uint64_t _a, _b, _c;
+};
+
+// activity of a decoded J_TICK
+struct JRNLACT
+{
+    vector<NID>        _nids;    // neurons that changed
+    vector<NEU_POTENT> _potent;
+    vector<NEU_STATE>  _state;
+    vector<char>       _flag;
+    vector<NID>        _queue[uJrnlQueues];
+};
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STATIC FUNCTIONS DEFINED IN THIS FILE
+//____________________________________________________________________
+static unsigned sPutVar (unsigned char *p, uint64_t v)
+{
+    unsigned n = 0;
+    while (v >= 0x80) {
+        p[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char)v;
+    return n;
+}
+
+static void sAddVar (vector<unsigned char> &vOut, uint64_t v)
+{
+    unsigned char buf[10];
+    vOut.insert (vOut.end(), buf, buf+sPutVar(buf,v));
+}
+
+static bool sGetVar (const unsigned char *&p, const unsigned char *e,
+                     uint64_t &v)
+{
+    unsigned s;
+    v = 0;
+    for (s=0; p<e && s<64; s+=7) {
+        unsigned char c = *p++;
+        v |= (uint64_t)(c & 0x7f) << s;
+        if (!(c & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the activity part of a J_TICK
+static bool sGetActivity (
+    const unsigned char *&p,
+    const unsigned char  *e,
+    NID                   tsize,
+    JRNLACT              &act)
+{
+    uint64_t uDiff, uPot, uState, uFlag, uLen, uNid;
+    NID      nid = 0;
+    unsigned q, k;
+    act._nids  .clear();
+    act._potent.clear();
+    act._state .clear();
+    act._flag  .clear();
+    for (;;) {
+        if (!sGetVar(p,e,uDiff)) {
+            return false;
+        }
+        if (uDiff == 0) {
+            break;
+        }
+        if (!sGetVar(p,e,uPot) || !sGetVar(p,e,uState) ||
+            !sGetVar(p,e,uFlag) || (uint64_t)nid + uDiff - 1 >= tsize ||
+            uPot > 255 || uState > NEURON::HYPER || uFlag > 255) {
+            return false;
+        }
+        nid += (NID)(uDiff - 1);
+        act._nids  .push_back(nid);
+        act._potent.push_back((NEU_POTENT)uPot);
+        act._state .push_back((NEU_STATE)uState);
+        act._flag  .push_back((char)uFlag);
+    }
+    foreach (q,0,uJrnlQueues) {
+        // every NID takes at least one byte
+        if (!sGetVar(p,e,uLen) || uLen > (uint64_t)(e-p)) {
+            return false;
+        }
+        act._queue[q].resize(uLen);
+        foreach (k,0,uLen) {
+            if (!sGetVar(p,e,uNid) || uNid >= tsize) {
+                return false;
+            }
+            act._queue[q][k] = (NID)uNid;
+        }
+    }
+    return true;
+}
+
+// decode the record at p and move past it; false at the end of the
+// log, or at a record that is cut short or damaged
+static bool sGetRecord (
+    const unsigned char *&p,
+    const unsigned char  *e,
+    NID                   tsize,
+    NID                   osize,
+    JRNLREC              &r,
+    vector<unsigned>     &vKeys,
+    JRNLACT              &act)
+{
+    if (p >= e || (*p & 0xf0)) {
+        return false;
+    }
+    r._op      = *p & 7;
+    r._delayed = (*p & 8) != 0;
+    p++;
+    r._a = r._b = r._c = 0;
+    switch (r._op) {
+    case JOURNAL::J_LINK:
+    case JOURNAL::J_WEAKEN:
+    case JOURNAL::J_REMOVE:
+    case JOURNAL::J_DEACTIVE:
+        return sGetVar(p,e,r._a) && sGetVar(p,e,r._b) &&
+               r._a < tsize && r._b < tsize;
+    case JOURNAL::J_ASSIGN: {
+        // every key takes at least one byte
+        if (!sGetVar(p,e,r._a) || !sGetVar(p,e,r._b) ||
+            r._a >= tsize || r._b > (uint64_t)(e-p)) {
+            return false;
+        }
+        vKeys.resize(r._b);
+        uint64_t uKey = 0, uDiff;
+        unsigned i;
+        foreach (i,0,r._b) {
+            if (!sGetVar(p,e,uDiff)) {
+                return false;
+            }
+            uKey += uDiff;
+            if ((uKey >> 1) >= tsize) {
+                return false;
+            }
+            vKeys[i] = (unsigned)uKey;
+        }
+        return true;
+    }
+    case JOURNAL::J_AGE:
+        return sGetVar(p,e,r._a) && sGetVar(p,e,r._b) &&
+               sGetVar(p,e,r._c) && r._a < tsize && r._b < tsize &&
+               r._c <= SYNAP::DECAY;
+    case JOURNAL::J_TICK:
+        return sGetVar(p,e,r._a) && sGetVar(p,e,r._b) &&
+               sGetVar(p,e,r._c) && r._b <= osize &&
+               sGetActivity(p,e,tsize,act);
+    default:
+        return false;
+    }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - JOURNAL
+//____________________________________________________________________
+JOURNAL::JOURNAL ()
+    : _fd(-1),_ring(new unsigned char [iRing]),_head(0),_tail(0),
+      _quit(false)
+{
+    pthread_mutex_init (&_mutex, 0);
+    pthread_cond_init  (&_more,  0);
+    pthread_cond_init  (&_space, 0);
+}
+
+JOURNAL::~JOURNAL ()
+{
+    Close();
+    pthread_mutex_destroy (&_mutex);
+    pthread_cond_destroy  (&_more);
+    pthread_cond_destroy  (&_space);
+    delete [] _ring;
+}
+
+bool JOURNAL::Open (const char *chFileName, long t, uint64_t base)
+{
+    Close();
+    _fd = open (chFileName, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (_fd < 0) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be opened!" << endl;
+        return false;
+    }
+    JRNLHEAD head;
+    memcpy (head._magic, chJrnlMagic, sizeof(chJrnlMagic));
+    head._version = uJrnlVersion;
+    head._pad     = 0;
+    head._time    = t;
+    head._base    = base;
+    if (write(_fd, &head, sizeof(head)) != (ssize_t)sizeof(head)) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be written!" << endl;
+        close (_fd);
+        _fd = -1;
+        return false;
+    }
+    _head = _tail = 0;
+    _quit = false;
+    if (pthread_create(&_thread, 0, Main, this) != 0) {
+        close (_fd);
+        _fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void JOURNAL::Close ()
+{
+    if (_fd < 0) {
+        return;
+    }
+    pthread_mutex_lock   (&_mutex);
+    _quit = true;
+    pthread_cond_signal  (&_more);
+    pthread_mutex_unlock (&_mutex);
+    pthread_join (_thread, 0);
+    fdatasync (_fd);
+    close (_fd);
+    _fd = -1;
+}
+
+void JOURNAL::Assign (NID nid, const SIGN &sign)
+{
+    unsigned char rec[64];
+    unsigned i, n=0, uPrev=0;
+    rec[n++] = J_ASSIGN;
+    n += sPutVar(rec+n, nid);
+    n += sPutVar(rec+n, sign.NumKeys());
+    foreach (i,0,sign.NumKeys()) {
+        if (n > sizeof(rec)-5) {
+            Put (rec, n);
+            n = 0;
+        }
+        n += sPutVar(rec+n, sign.Keys()[i] - uPrev);
+        uPrev = sign.Keys()[i];
+    }
+    Put (rec, n);
+}
+
+void JOURNAL::Age (NID src, NID dst, unsigned age)
+{
+    unsigned char rec[16];
+    unsigned n=0;
+    rec[n++] = J_AGE;
+    n += sPutVar(rec+n, src);
+    n += sPutVar(rec+n, dst);
+    n += sPutVar(rec+n, age);
+    Put (rec, n);
+}
+
+void JOURNAL::Tick (
+    long     t,
+    NID      next,
+    uint64_t count,
+    const vector<unsigned char> &act)
+{
+    unsigned char rec[32];
+    unsigned n=0;
+    rec[n++] = J_TICK;
+    n += sPutVar(rec+n, (uint64_t)t);
+    n += sPutVar(rec+n, next);
+    n += sPutVar(rec+n, count);
+    Put (rec, n);
+    if (!act.empty()) {
+        Put (&act[0], act.size());
+    }
+}
+
+void JOURNAL::Put (OP op, NID src, NID dst, bool bDelay)
+{
+    unsigned char rec[16];
+    unsigned n=0;
+    rec[n++] = (unsigned char)(op | (bDelay ? 8 : 0));
+    n += sPutVar(rec+n, src);
+    n += sPutVar(rec+n, dst);
+    Put (rec, n);
+}
+
+// copy into the ring; waits only if the writer is a full ring behind
+void JOURNAL::Put (const unsigned char *p, unsigned n)
+{
+    unsigned uUsed = _head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+    bool bLow = uUsed < iRing/2;
+    while (n) {
+        uUsed = _head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+        if (uUsed == iRing) {
+            pthread_mutex_lock (&_mutex);
+            pthread_cond_signal (&_more);
+            while (_head - __atomic_load_n(&_tail,__ATOMIC_ACQUIRE) == iRing) {
+                pthread_cond_wait (&_space, &_mutex);
+            }
+            pthread_mutex_unlock (&_mutex);
+            continue;
+        }
+        unsigned uPos = _head & (iRing-1);
+        unsigned k    = n;
+        if (k > iRing-uUsed) { k = iRing-uUsed; }
+        if (k > iRing-uPos)  { k = iRing-uPos;  }
+        memcpy (_ring+uPos, p, k);
+        __atomic_store_n (&_head, _head+k, __ATOMIC_RELEASE);
+        p += k;
+        n -= k;
+    }
+    // wake the writer once the ring is half full
+    uUsed = _head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+    if (bLow && uUsed >= iRing/2) {
+        pthread_mutex_lock   (&_mutex);
+        pthread_cond_signal  (&_more);
+        pthread_mutex_unlock (&_mutex);
+    }
+}
+
+void * JOURNAL::Main (void *p)
+{
+    ((JOURNAL *)p)->Loop();
+    return 0;
+}
+
+// the writer: drain the ring when woken, or every 100ms
+void JOURNAL::Loop ()
+{
+    bool bFailed = false;
+    for (;;) {
+        pthread_mutex_lock (&_mutex);
+        if (!_quit && __atomic_load_n(&_head,__ATOMIC_ACQUIRE) == _tail) {
+            struct timeval  now;
+            struct timespec ts;
+            gettimeofday (&now, 0);
+            ts.tv_sec  = now.tv_sec;
+            ts.tv_nsec = now.tv_usec * 1000 + 100000000;
+            if (ts.tv_nsec >= 1000000000) {
+                ts.tv_sec  ++;
+                ts.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait (&_more, &_mutex, &ts);
+        }
+        bool bQuit = _quit;
+        pthread_mutex_unlock (&_mutex);
+
+        unsigned uHead = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+        unsigned uTail = _tail;
+        while (uTail != uHead) {
+            unsigned uPos = uTail & (iRing-1);
+            unsigned k    = uHead - uTail;
+            if (k > iRing-uPos) { k = iRing-uPos; }
+            ssize_t w = bFailed ? (ssize_t)k : write(_fd, _ring+uPos, k);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            if (w <= 0) {
+                // keep the learner going; the log ends here
+                cerr << "ERROR: journal cannot be written!" << endl;
+                bFailed = true;
+                continue;
+            }
+            uTail += w;
+        }
+        pthread_mutex_lock     (&_mutex);
+        __atomic_store_n (&_tail, uTail, __ATOMIC_RELEASE);
+        pthread_cond_broadcast (&_space);
+        pthread_mutex_unlock   (&_mutex);
+        if (bQuit && uTail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS NET  MEMBER FUNCTIONS
+//____________________________________________________________________
+
+// the state a journal builds on: live links with their synapses,
+// signatures, activity, firing queues and the clocks
+uint64_t NET::Fingerprint ()
+{
+    uint64_t h = RNG::Mix(_time);
+    h = RNG::Mix(h ^ _nextOutput);
+    h = RNG::Mix(h ^ _rng.Key());
+    h = RNG::Mix(h ^ _rng.Count());
+    NID i;
+    foreach (i,0,TSIZE) {
+        NEURON neu = Neu(i);
+        LINKS &links = neu.Links();
+        LINKS::iterator it;
+        foreachv (it, links) {
+            uint32_t uSyn;
+            memcpy (&uSyn, &(*it).Syn(), sizeof(uSyn));
+            h = RNG::Mix(h ^ ((uint64_t)(*it).Nid() << 32 | uSyn));
+        }
+        h = RNG::Mix(h ^ neu.Sign().Hash() ^ links.size());
+        h = RNG::Mix(h ^ (uint64_t)(unsigned short)neu.Potential() ^
+                     (uint64_t)(unsigned char)neu.State() << 16 ^
+                     (uint64_t)(unsigned char)_pool.Flag()[i] << 24);
+    }
+    FRONT *pQueues[uJrnlQueues] = {
+        _firingPrio, _firingCurr, _firingWavf, _firingWavb, &_firingBake };
+    unsigned q;
+    foreach (q,0,uJrnlQueues) {
+        FRONT::iterator it;
+        h = RNG::Mix(h ^ pQueues[q]->size());
+        foreachv (it, (*pQueues[q])) {
+            h = RNG::Mix(h ^ *it);
+        }
+    }
+    return h;
+}
+
+// final ages of the links aged in this Update, then the end mark
+// with the activity that changed since the last one
+void NET::JournalTick ()
+{
+    FRONT::iterator itSrc;
+    foreachv (itSrc, _aged) {
+        LINKS &links = Neu(*itSrc).Links();
+        LINKS::iterator it;
+        foreachv (it, links) {
+            _journal->Age(*itSrc, (*it).Nid(), (*it).Syn().Age());
+        }
+    }
+    _aged.Clear();
+
+    const NEU_POTENT *pPotent = _pool.Potent();
+    const NEU_STATE  *pState  = _pool.State();
+    const char       *pFlag   = _pool.Flag();
+    NID i, uPrev = 0;
+    _jrnlAct.clear();
+    foreach (i,0,TSIZE) {
+        if (pPotent[i] == _jrnlPotent[i] && pState[i] == _jrnlState[i] &&
+            pFlag[i]   == _jrnlFlag[i]) {
+            continue;
+        }
+        sAddVar (_jrnlAct, i - uPrev + 1);
+        sAddVar (_jrnlAct, (unsigned short)pPotent[i]);
+        sAddVar (_jrnlAct, (unsigned char)pState[i]);
+        sAddVar (_jrnlAct, (unsigned char)pFlag[i]);
+        _jrnlPotent[i] = pPotent[i];
+        _jrnlState [i] = pState[i];
+        _jrnlFlag  [i] = pFlag[i];
+        uPrev = i;
+    }
+    sAddVar (_jrnlAct, 0);
+    FRONT *pQueues[uJrnlQueues] = {
+        _firingPrio, _firingCurr, _firingWavf, _firingWavb, &_firingBake };
+    unsigned q;
+    foreach (q,0,uJrnlQueues) {
+        FRONT::iterator it;
+        sAddVar (_jrnlAct, pQueues[q]->size());
+        foreachv (it, (*pQueues[q])) {
+            sAddVar (_jrnlAct, *it);
+        }
+    }
+    _journal->Tick(_time, _nextOutput, _rng.Count(), _jrnlAct);
+}
+
+// start a fresh log on top of the current state
+bool NET::Journal (const char *chFileName)
+{
+    if (!_journal) {
+        _journal = new JOURNAL;
+    }
+    _pool.Journal(0);
+    _aged.Clear();
+    _jrnlPotent.assign(_pool.Potent(), _pool.Potent()+TSIZE);
+    _jrnlState .assign(_pool.State(),  _pool.State() +TSIZE);
+    _jrnlFlag  .assign(_pool.Flag(),   _pool.Flag()  +TSIZE);
+    if (!_journal->Open(chFileName, _time, Fingerprint())) {
+        return false;
+    }
+    _pool.Journal(_journal);
+    return true;
+}
+
+// apply a log made on top of the current state, up to the last
+// complete Update
+bool NET::Replay (const char *chFileName)
+{
+    ifstream in (chFileName, ios::in|ios::binary|ios::ate);
+    if (!in.is_open()) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be opened!" << endl;
+        return false;
+    }
+    vector<unsigned char> vLog ((size_t)in.tellg());
+    in.seekg (0, ios::beg);
+    if (!vLog.empty()) {
+        in.read ((char *)&vLog[0], vLog.size());
+    }
+    in.close();
+    JRNLHEAD head;
+    if (vLog.size() < sizeof(head)) {
+        cerr << "ERROR: "<<chFileName<<": not a journal" << endl;
+        return false;
+    }
+    memcpy (&head, &vLog[0], sizeof(head));
+    if (memcmp(head._magic, chJrnlMagic, sizeof(chJrnlMagic)) != 0 ||
+        head._version != uJrnlVersion) {
+        cerr << "ERROR: "<<chFileName<<": not a journal" << endl;
+        return false;
+    }
+    if (head._time != _time) {
+        cerr << "ERROR: "<<chFileName<<": journal starts at time "
+             << head._time << ", net is at " << _time << endl;
+        return false;
+    }
+    if (head._base != Fingerprint()) {
+        cerr << "ERROR: "<<chFileName<<": journal was not made on "
+             << "this state" << endl;
+        return false;
+    }
+    const unsigned char *pBeg = &vLog[0] + sizeof(head);
+    const unsigned char *pEnd = &vLog[0] + vLog.size();
+    const unsigned char *p    = pBeg;
+    const unsigned char *pLast= pBeg;   // end of the last tick
+    JRNLREC          r;
+    JRNLACT          act;
+    vector<unsigned> vKeys;
+    unsigned uTicks = 0;
+    while (sGetRecord(p, pEnd, TSIZE, OSIZE, r, vKeys, act)) {
+        if (r._op == JOURNAL::J_TICK) {
+            pLast = p;
+            uTicks++;
+        }
+    }
+    if (uTicks == 0) {
+        return true;
+    }
+    // replayed changes must not be logged again
+    _pool.Journal(0);
+    p = pBeg;
+    FRONT *pQueues[uJrnlQueues] = {
+        _firingPrio, _firingCurr, _firingWavf, _firingWavb, &_firingBake };
+    unsigned i, q;
+    while (p < pLast &&
+           sGetRecord(p, pLast, TSIZE, OSIZE, r, vKeys, act)) {
+        NEURON neu = Neu((NID)r._a);
+        switch (r._op) {
+        case JOURNAL::J_LINK:
+            neu.Link((NID)r._b, r._delayed);
+            break;
+        case JOURNAL::J_WEAKEN:
+            neu.LinkWeaken((NID)r._b, r._delayed);
+            break;
+        case JOURNAL::J_REMOVE:
+            neu.LinkRemove((NID)r._b);
+            break;
+        case JOURNAL::J_DEACTIVE:
+            neu.LinkDeactive((NID)r._b, r._delayed);
+            break;
+        case JOURNAL::J_ASSIGN:
+            neu.Sign().Assign(vKeys.empty() ? 0 : &vKeys[0], vKeys.size());
+            break;
+        case JOURNAL::J_AGE: {
+            LINK *pConn = neu.Links().Find((NID)r._b);
+            if (pConn) {
+                pConn->Syn().AgeSet((unsigned)r._c);
+            }
+            break;
+        }
+        case JOURNAL::J_TICK:
+            _time       = (long)r._a;
+            _nextOutput = (NID)r._b;
+            _rng.Restore(_rng.Key(), r._c);
+            foreach (i,0,act._nids.size()) {
+                _pool.Potent()[act._nids[i]] = act._potent[i];
+                _pool.State() [act._nids[i]] = act._state[i];
+                _pool.Flag()  [act._nids[i]] = act._flag[i];
+            }
+            foreach (q,0,uJrnlQueues) {
+                pQueues[q]->Clear();
+                foreach (i,0,act._queue[q].size()) {
+                    pQueues[q]->Push(act._queue[q][i]);
+                }
+            }
+            break;
+        }
+    }
+    _pool.Journal(_journal);
+    delete _frozen;
+    _frozen = 0;
+    _bbs.Clear();
+    StateClear();
+    InputScan();
+    if (_verbose >= 2) {
+        cout << "replayed " << uTicks << " updates from "
+             << chFileName << endl;
+    }
+    return true;
+}
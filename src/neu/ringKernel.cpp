@@ -0,0 +1,250 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : ringKernel.cpp
+//
+// DESCRIPTION :
+//    Energy distribution kernels used by NET::Propagate:
+//    share[i] = floor(energy * w[i] / total), in fixed point.
+//
+//    The division is replaced by a multiplication with the
+//    reciprocal m = floor(2^32/total)+1, keeping the upper 32 bits.
+//    With x = energy*w[i] and m*total = 2^32 + e (0 < e <= total),
+//    the result is exact as long as x*total < 2^32; that holds for
+//    energy < 256, w < 256, total < 65536, which Split() checks.
+//    The SSE2 kernel also needs x < 65536 for its 16-bit products,
+//    which the same bounds give.  SYNAP weights are at most 15.
+
+#include "ring.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RING_X86
+#include <immintrin.h>
+#endif
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STATIC FUNCTIONS DEFINED IN THIS FILE
+//____________________________________________________________________
+
+// reciprocal of the total; total must be at least 2
+static inline unsigned sReciprocal (unsigned total)
+{
+    return (unsigned)((1ULL << 32) / total) + 1;
+}
+
+static inline unsigned sShare (unsigned x, unsigned m)
+{
+    return (unsigned)(((uint64_t)x * m) >> 32);
+}
+
+// bits set in any weight; above 255 if some weight is
+static unsigned sWeightBits (const ENERGY::WEIGHT *w, unsigned n)
+{
+    unsigned i, uOr=0;
+    foreach (i,0,n) {
+        uOr |= w[i];
+    }
+    return uOr;
+}
+
+// shares for trivial totals, where no reciprocal is needed
+static bool sSplitTrivial (
+    unsigned energy,
+    unsigned total,
+    const ENERGY::WEIGHT *w,
+    unsigned *share,
+    unsigned n)
+{
+    unsigned i;
+    if (total == 0) {
+        foreach (i,0,n) { share[i] = 0; }
+        return true;
+    }
+    if (total == 1) {
+        foreach (i,0,n) { share[i] = energy * w[i]; }
+        return true;
+    }
+    return false;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// ENERGY KERNELS
+//____________________________________________________________________
+
+// reference path: plain integer division
+void ENERGY::SplitScalar (
+    unsigned energy,
+    unsigned total,
+    const WEIGHT *w,
+    unsigned *share,
+    unsigned n)
+{
+    if (sSplitTrivial(energy,total,w,share,n)) {
+        return;
+    }
+    unsigned i;
+    foreach (i,0,n) {
+        share[i] = (energy * w[i]) / total;
+    }
+}
+
+// the float path Propagate used before; kept for comparison only
+void ENERGY::SplitFloat (
+    unsigned energy,
+    unsigned total,
+    const WEIGHT *w,
+    unsigned *share,
+    unsigned n)
+{
+    unsigned i;
+    foreach (i,0,n) {
+        float ratio = ((float)w[i])/((float)total);
+        share[i] = (unsigned)((float)energy * ratio);
+    }
+}
+
+#ifdef RING_X86
+
+// 8 weights per step: 16-bit products, then two 32x32->64 bit
+// multiplies for the even and odd lanes of each half.
+__attribute__((target("sse2")))
+void ENERGY::SplitSSE2 (
+    unsigned energy,
+    unsigned total,
+    const WEIGHT *w,
+    unsigned *share,
+    unsigned n)
+{
+    if (sSplitTrivial(energy,total,w,share,n)) {
+        return;
+    }
+    unsigned m = sReciprocal(total);
+    const __m128i vE    = _mm_set1_epi16((short)energy);
+    const __m128i vM    = _mm_set1_epi32((int)m);
+    const __m128i vZero = _mm_setzero_si128();
+    const __m128i vHigh = _mm_set_epi32(-1,0,-1,0);
+    unsigned i=0;
+    for (; i+8 <= n; i+=8) {
+        __m128i x  = _mm_mullo_epi16(
+            _mm_loadu_si128((const __m128i *)(w+i)), vE);
+        __m128i xs[2];
+        xs[0] = _mm_unpacklo_epi16(x, vZero);
+        xs[1] = _mm_unpackhi_epi16(x, vZero);
+        for (unsigned h=0; h<2; h++) {
+            __m128i ev = _mm_mul_epu32(xs[h], vM);
+            __m128i od = _mm_mul_epu32(_mm_srli_epi64(xs[h],32), vM);
+            __m128i r  = _mm_or_si128(_mm_srli_epi64(ev,32),
+                                      _mm_and_si128(od, vHigh));
+            _mm_storeu_si128((__m128i *)(share+i+4*h), r);
+        }
+    }
+    for (; i<n; i++) {
+        share[i] = sShare(energy * w[i], m);
+    }
+}
+
+// 8 weights per step, widened to 32 bits up front
+__attribute__((target("avx2")))
+void ENERGY::SplitAVX2 (
+    unsigned energy,
+    unsigned total,
+    const WEIGHT *w,
+    unsigned *share,
+    unsigned n)
+{
+    if (sSplitTrivial(energy,total,w,share,n)) {
+        return;
+    }
+    unsigned m = sReciprocal(total);
+    const __m256i vE    = _mm256_set1_epi32((int)energy);
+    const __m256i vM    = _mm256_set1_epi32((int)m);
+    const __m256i vHigh = _mm256_set_epi32(-1,0,-1,0,-1,0,-1,0);
+    unsigned i=0;
+    for (; i+8 <= n; i+=8) {
+        __m256i x  = _mm256_mullo_epi32(_mm256_cvtepu16_epi32(
+            _mm_loadu_si128((const __m128i *)(w+i))), vE);
+        __m256i ev = _mm256_mul_epu32(x, vM);
+        __m256i od = _mm256_mul_epu32(_mm256_srli_epi64(x,32), vM);
+        __m256i r  = _mm256_or_si256(_mm256_srli_epi64(ev,32),
+                                     _mm256_and_si256(od, vHigh));
+        _mm256_storeu_si256((__m256i *)(share+i), r);
+    }
+    for (; i<n; i++) {
+        share[i] = sShare(energy * w[i], m);
+    }
+}
+
+#else
+
+void ENERGY::SplitSSE2 (
+    unsigned energy, unsigned total,
+    const WEIGHT *w, unsigned *share, unsigned n)
+{
+    SplitScalar (energy,total,w,share,n);
+}
+
+void ENERGY::SplitAVX2 (
+    unsigned energy, unsigned total,
+    const WEIGHT *w, unsigned *share, unsigned n)
+{
+    SplitScalar (energy,total,w,share,n);
+}
+
+#endif
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// RUNTIME DISPATCH
+//____________________________________________________________________
+typedef void (*SPLIT_FUNC)(unsigned,unsigned,
+                           const ENERGY::WEIGHT *,unsigned *,unsigned);
+
+// picked once, before the first split, by whichever thread gets
+// there first (workers of NET::Fire may)
+static pthread_once_t onceSplit = PTHREAD_ONCE_INIT;
+static SPLIT_FUNC     pSplit    = 0;
+static const char    *chSplit   = 0;
+
+static void sSelectKernel ()
+{
+    pSplit  = ENERGY::SplitScalar;
+    chSplit = "scalar";
+#ifdef RING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        pSplit  = ENERGY::SplitAVX2;
+        chSplit = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        pSplit  = ENERGY::SplitSSE2;
+        chSplit = "sse2";
+    }
+#endif
+}
+
+// kernels are exact only for energy < 256, w < 256 and total < 65536;
+// outside that range fall back to the division.  A weight can exceed
+// 255 only if the total does, so the weights are looked at only then.
+void ENERGY::Split (
+    unsigned energy,
+    unsigned total,
+    const WEIGHT *w,
+    unsigned *share,
+    unsigned n)
+{
+    pthread_once (&onceSplit, sSelectKernel);
+    if (energy > 255 || total > 65535 ||
+        (total > 255 && sWeightBits(w,n) > 255)) {
+        SplitScalar (energy,total,w,share,n);
+    } else {
+        pSplit (energy,total,w,share,n);
+    }
+}
+
+const char * ENERGY::Kernel ()
+{
+    pthread_once (&onceSplit, sSelectKernel);
+    return chSplit;
+}
@@ -0,0 +1,195 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : ringLinks.cpp
+//
+// DESCRIPTION :
+//    Flat synapse storage: sorted per-neuron link arrays (LINKS)
+//    carved out of a shared memory pool (SLAB).
+
+#include <string.h>
+#include "ring.h"
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - SLAB
+//____________________________________________________________________
+SLAB::SLAB () : _page(0),_used(iPageSize)
+{
+    unsigned i;
+    foreach (i,0,iClasses) {
+        _free[i] = 0;
+    }
+}
+
+SLAB::~SLAB ()
+{
+    vector<LINK *>::iterator it;
+    foreachv (it,_pages) {
+        delete [] (*it);
+    }
+}
+
+// size class of a power-of-two capacity
+unsigned SLAB::Class (unsigned cap)
+{
+    unsigned c=0;
+    while ((1u<<c) < cap) {
+        c++;
+    }
+    return c;
+}
+
+// take a segment from the free list of its size class;
+// otherwise carve it from the current page.
+LINK * SLAB::Alloc (unsigned cap)
+{
+    unsigned c = Class(cap);
+    LINK *seg = _free[c];
+    if (seg) {
+        // the next free segment is stored in the segment itself
+        memcpy (&_free[c], seg, sizeof(LINK *));
+        return seg;
+    }
+    if (cap > iPageSize) {
+        // oversized segments get a page of their own
+        seg = new LINK [cap];
+        _pages.push_back(seg);
+        return seg;
+    }
+    if (_used + cap > iPageSize) {
+        _page = new LINK [iPageSize];
+        _pages.push_back(_page);
+        _used = 0;
+    }
+    seg    = _page + _used;
+    _used += cap;
+    return seg;
+}
+
+void SLAB::Free (LINK *seg, unsigned cap)
+{
+    unsigned c = Class(cap);
+    memcpy ((void *)seg, &_free[c], sizeof(LINK *));
+    _free[c] = seg;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - LINKS
+//____________________________________________________________________
+
+// first slot whose target is not less than the given NID
+LINK * LINKS::Lower (NID nid)
+{
+    unsigned lo=0, hi=_size;
+    while (lo < hi) {
+        unsigned mid = (lo+hi)/2;
+        if (_data[mid].Nid() < nid) {
+            lo = mid+1;
+        } else {
+            hi = mid;
+        }
+    }
+    return _data+lo;
+}
+
+LINK * LINKS::Find (NID nid)
+{
+    LINK *p = Lower(nid);
+    if (p!=_data+_size && p->Nid()==nid && !p->Dead()) {
+        return p;
+    }
+    return 0;
+}
+
+LINK * LINKS::Insert (NID nid, SYNAP syn)
+{
+    LINK *p = Lower(nid);
+    if (p!=_data+_size && p->Nid()==nid) {
+        // revive the tombstone in place
+        assert (p->Dead());
+        *p = LINK(nid,syn);
+        _live++;
+        return p;
+    }
+    if (_size == _cap) {
+        Grow();
+        p = Lower(nid);
+    }
+    // shift the tail to open a slot
+    memmove ((void *)(p+1), p, sizeof(LINK) * (_data+_size-p));
+    *p = LINK(nid,syn);
+    _size++;
+    _live++;
+    return p;
+}
+
+// the link may already be weakened down to zero weight
+void LINKS::Erase (LINK *p)
+{
+    p->Syn().Kill();
+    _live--;
+}
+
+void LINKS::Attach (LINK *data, unsigned size, unsigned cap)
+{
+    if (_data) {
+        _slab->Free(_data,_cap);
+    }
+    _data = cap ? data : 0;
+    _size = _live = size;
+    _cap  = cap;
+}
+
+// merge from the back, so each link moves at most once
+void LINKS::Merge (const NID *nids, unsigned n, SYNAP syn)
+{
+    if (_size + n > _cap) {
+        Grow(n);
+    }
+    int i = (int)_size-1;
+    int j = (int)n-1;
+    unsigned k = _size + n;
+    while (j >= 0) {
+        if (i >= 0 && _data[i].Nid() > nids[j]) {
+            _data[--k] = _data[i--];
+        } else {
+            assert (i < 0 || _data[i].Nid() != nids[j]);
+            _data[--k] = LINK(nids[j--],syn);
+        }
+    }
+    _size += n;
+    _live += n;
+}
+
+// make room for n more links:
+// squeeze out tombstones if there are many; else double the segment.
+void LINKS::Grow (unsigned uMore)
+{
+    LINK *src = _data;
+    LINK *dst = _data;
+    unsigned cap = _cap;
+    if ((_size-_live)*4 < _cap || _live+uMore > _cap) {
+        cap = _cap ? 2*_cap : 2;
+        while (cap < _live+uMore) {
+            cap *= 2;
+        }
+        dst = _slab->Alloc(cap);
+    }
+    unsigned i, n=0;
+    foreach (i,0,_size) {
+        if (!src[i].Dead()) {
+            dst[n++] = src[i];
+        }
+    }
+    if (dst != src) {
+        if (src) {
+            _slab->Free(src,_cap);
+        }
+        _data = dst;
+        _cap  = cap;
+    }
+    _size = n;
+}
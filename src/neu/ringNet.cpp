@@ -5,6 +5,8 @@
 // Revision [$Id: ringNet.cpp,v 1.12 2008-06-08 00:05:59 wjiang Exp $]
 //
 
+#include <string.h>
+#include <sys/mman.h>
 #include "ring.h"
 
 
@@ -14,13 +16,13 @@
 //____________________________________________________________________
 enum LINK_PROCESS_TYPE { LINK_WEAKEN, LINK_DEACTIVE };
 
-static int  netGetNumLevels_rec(NET &, NEURON &);
-static void netLevelize_rec (NET &,NEURON &,vector<NID> *);
+static int  netGetNumLevels_rec(NET &, NEURON);
+static void netLevelize_rec (NET &,NEURON,vector<NID> *);
 static void netProcessUniquePattern (NET &,BBS &);
 static void netProcessStampLinks(NET &,STAMP &,NID,LINK_PROCESS_TYPE);
-static void netReportQueue     (NET &, list<NID> *);
-static void netPushFiringQueue (NET &, NID, list<NID> *);
-static void netPushBakingQueue (NET &, NID, list<NID> &);
+static void netReportQueue     (NET &, FRONT *);
+static void netPushFiringQueue (NET &, NID, FRONT *);
+static void netPushBakingQueue (NET &, NID, FRONT &);
 
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -38,37 +40,43 @@ static void RingMsg(int id, const char *msg)
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // CLASS NET  MEMBER FUNCTIONS
 //____________________________________________________________________
-NET::NET (NID inc)
+NET::NET (NID inc, uint64_t seed)
     : RSIZE(1),
       ISIZE(inc),          // input size
       OSIZE(inc*20),       // output size
       NSIZE(inc*100),      // internal neuron size
       TSIZE(OSIZE+NSIZE),  // total neuron size
-      _neurons (new NEURON [TSIZE]),
+      _pool    (TSIZE),
       _inputs  (new NID [ISIZE]),
       _outputs (new NID [OSIZE]),
-      _nextOutput(0),_bbs(*this),_time(0),_verbose(3)
+      _nextOutput(0),_on((ISIZE+63)/64,0),_rng(seed),
+      _firingBake(TSIZE),_bbs(*this),
+      _mark(TSIZE,0),_markStamp(0),_tpool(0),
+      _undoAt(new UNDO [TSIZE]),_epoch(1),_time(0),_verbose(3),
+      _threshold(128),_snap(0),_snapSize(0),_journal(0),
+      _aged(TSIZE),_frozen(0)
 {
     int i;
+    memset (_undoAt, 0, sizeof(UNDO) * TSIZE);
     foreach (i,0,ISIZE) {
         _inputs[i] = i;
-        _neurons[i].Id(i);
-        _neurons[i].Type(INPUT);
+        Neu(i).Type(INPUT);
     }
     foreach (i,ISIZE,NSIZE) {
-        _neurons[i].Id(i);
-        _neurons[i].Type(INTERNAL);
+        Neu(i).Type(INTERNAL);
     }
     foreach (i,0,OSIZE) {
         _outputs[i] = NSIZE+i;
-        _neurons[NSIZE+i].Id(NSIZE+i);
-        _neurons[NSIZE+i].Type(OUTPUT);
+        Neu(NSIZE+i).Type(OUTPUT);
     }
-    _firingPrio = new list<NID>;
-    _firingCurr = new list<NID>;
-    _firingWavf = new list<NID>;
-    _firingWavb = new list<NID>;
-    srand ( 1234567 /*time(NULL)*/ );
+    foreach (i,0,TSIZE) {
+        Neu(i).Links().Slab(&_slab);
+        Neu(i).InLinks().Slab(&_slab);
+    }
+    _firingPrio = new FRONT(TSIZE);
+    _firingCurr = new FRONT(TSIZE);
+    _firingWavf = new FRONT(TSIZE);
+    _firingWavb = new FRONT(TSIZE);
 }
 NET::~NET ()
 {
@@ -76,6 +84,13 @@ NET::~NET ()
     delete _firingCurr;
     delete _firingWavf;
     delete _firingWavb;
+    delete [] _undoAt;
+    delete _tpool;
+    delete _journal;
+    delete _frozen;
+    if (_snap) {
+        munmap (_snap, _snapSize);
+    }
 }
 
 
@@ -86,54 +101,154 @@ void NET::Input (PAD stimuli)
     foreach (i,0,ISIZE) {
         if (stimuli[i]) {
             Get(_inputs[i]).Excite(NEURON::EXCITE_HIGH);
+            _on[i/64] |=  ((uint64_t)1 << (i%64));
         } else {
             Get(_inputs[i]).State(NEURON::QUIET);
+            _on[i/64] &= ~((uint64_t)1 << (i%64));
         }
     }
+    InputActive();
 }
 
 // update input-neuron state based on image pad
 void NET::Input (IPAD &ipad) 
 {
-    unsigned x,y,i;
-    i=0;
-    foreach (y,0,ipad.height()) {
-        foreach (x,0,ipad.width()) {
-            if (ipad.Pix(x,y)) {
-                Get(_inputs[i]).Excite(NEURON::EXCITE_HIGH);
-            } else {
-                Get(_inputs[i]).State(NEURON::QUIET);
-            }
-            i++;
+    // input neurons are the first ISIZE of the pool; against the
+    // bits of the last frame (_on) only the pixels that turned off
+    // are quieted, and the ones that are on are excited
+    const uint64_t *pBits  = ipad.Bits(_threshold);
+    NEU_STATE      *pState = _pool.State();
+    NID uSize = ipad.size() < ISIZE ? ipad.size() : ISIZE;
+    NID w;
+    _active.clear();
+    foreach (w,0,_on.size()) {
+        NID uBeg = w*64;
+        uint64_t b = 0, uMask = 0;
+        if (uBeg < uSize) {
+            uMask = uSize-uBeg < 64 ? ((uint64_t)1 << (uSize-uBeg))-1
+                                    : ~(uint64_t)0;
+            b = pBits[w] & uMask;
+        }
+        uint64_t off = _on[w] & uMask & ~b;
+        _on[w] = (_on[w] & ~uMask) | b;
+        while (off) {
+            pState[uBeg + __builtin_ctzll(off)] = NEURON::QUIET;
+            off &= off - 1;
+        }
+        b = _on[w];
+        while (b) {
+            NID i = uBeg + __builtin_ctzll(b);
+            Neu(i).Excite(NEURON::EXCITE_HIGH);
+            _active.push_back(i);
+            b &= b - 1;
         }
     }
 }
 
+void NET::Input (const NID *pOn, unsigned n)
+{
+    NEU_STATE *pState = _pool.State();
+    vector<NID>::iterator it;
+    foreachv (it, _active) {
+        pState[*it] = NEURON::QUIET;
+        _on[*it/64] &= ~((uint64_t)1 << (*it%64));
+    }
+    _active.clear();
+    unsigned k;
+    foreach (k,0,n) {
+        if (pOn[k] < ISIZE) {
+            Neu(pOn[k]).Excite(NEURON::EXCITE_HIGH);
+            _on[pOn[k]/64] |= ((uint64_t)1 << (pOn[k]%64));
+            _active.push_back(pOn[k]);
+        }
+    }
+    sort (_active.begin(), _active.end());
+}
+
+// Cool drains the input potentials after each update, so the inputs
+// that stay on are excited again; the ones that turned off are quieted
+void NET::InputDelta (const uint64_t *pDelta)
+{
+    NEU_STATE *pState = _pool.State();
+    NID w;
+    foreach (w,0,_on.size()) {
+        uint64_t d = pDelta[w];
+        if (w == _on.size()-1 && ISIZE%64) {
+            d &= ((uint64_t)1 << (ISIZE%64)) - 1;
+        }
+        uint64_t off = d & _on[w];
+        _on[w] ^= d;
+        while (off) {
+            pState[w*64 + __builtin_ctzll(off)] = NEURON::QUIET;
+            off &= off - 1;
+        }
+    }
+    InputActive();
+    vector<NID>::iterator it;
+    foreachv (it, _active) {
+        Neu(*it).Excite(NEURON::EXCITE_HIGH);
+    }
+}
+
+void NET::InputActive ()
+{
+    _active.clear();
+    NID w;
+    foreach (w,0,_on.size()) {
+        uint64_t b = _on[w];
+        while (b) {
+            _active.push_back(w*64 + __builtin_ctzll(b));
+            b &= b - 1;
+        }
+    }
+}
+
+// only Input changes the input neurons, so the awake ones are on
+void NET::InputScan ()
+{
+    NID i;
+    foreach (i,0,ISIZE) {
+        if (Neu(i).State() != NEURON::QUIET) {
+            _on[i/64] |=  ((uint64_t)1 << (i%64));
+        } else {
+            _on[i/64] &= ~((uint64_t)1 << (i%64));
+        }
+    }
+    InputActive();
+}
+
 // train the network with animation movie
 void NET::Train (IMOV &imov)
 {
-    // foreach IPAD frame
-    vector<IPAD*>::iterator it;
-    foreachv (it, imov.ipads()) {
-        // extract pixels 
-        Input(*(*it));
-        // update neural network
-        Update();
+    // foreach IPAD frame, made as it is pulled
+    IPAD *pad;
+    while ((pad = imov.Next()) != 0) {
+        Train (*pad);
     }
 }
 
+// train the network with one frame
+void NET::Train (IPAD &pad)
+{
+    Input(pad);
+    // update neural network
+    Update();
+}
+
 // update internal-neuron states based on input neurons
 void NET::Update () 
 {
     int i;
     RingMsg(_time, "...... ......");
+    // links are about to change
+    delete _frozen;
+    _frozen = 0;
     
     RandomFire();
     RealFire(FIRING_INPUT);
     
     // do the same for excited neurons; propagate wave-front
     // in multiple iteration; process unique patterns in each front.
-    list<NID>::iterator it;
     while (ProcessFiringQueue()) {
         RealFire(FIRING_CURRENT);
         if (_verbose >= 3) {
@@ -144,13 +259,16 @@ void NET::Update ()
     Cool();
     Report();
     Advance();
+    if (_journal) {
+        JournalTick();
+    }
 }
 
 
 // first connect; then propagate energy
 bool NET::Update(
-    NEURON    &neu,     // firing neuron
-    list<NID> *qFiring, // target firing queue for excited neurons
+    NEURON     neu,     // firing neuron
+    FRONT     *qFiring, // target firing queue for excited neurons
     bool       bDelay)  // whether its delayed firing
 {
     bool bResult=false;
@@ -183,70 +301,89 @@ bool NET::Update(
 // - check delayed edge with delay-firing status
 // 
 bool NET::Propagate(
-    NEURON    &neu, 
-    list<NID> *qFiring,
+    NEURON     neu, 
+    FRONT     *qFiring,
     bool       bDelay)
 {
     // compute all link-strength;
     // linearly distribute energy among links based on its strength
     bool bPropagated = false;
-    unsigned uTotal  = 0;
-    unsigned uEnergy = neu.Potential();
-    map<NID,SYNAP>& mL=neu.Links();
-    map<NID,SYNAP>::iterator it;
-    // propagate energy only to those winners of the temporary firing
-    foreachv (it, mL) {
-        if ((*it).second.Delayed()==bDelay && 
-            (!qFiring || _bbs.Exists((*it).first))) {
-            uTotal += (*it).second.Weight();
-        }
+    unsigned i, n = Spread (neu, qFiring!=0, bDelay, _spread);
+    if (_journal && n) {
+        _aged.Push(neu.Id());
     }
-    foreachv (it, mL) {
-        if ((*it).second.Delayed()!=bDelay ||
-            !(!qFiring || _bbs.Exists((*it).first))) {
-            continue;
-        }
-        NEURON &neu2 = Get((*it).first);
-        float ratio = (((float)(*it).second.Weight())/((float)uTotal));
-        unsigned uShare = (unsigned)((float)uEnergy * ratio);
+    foreach (i,0,n) {
+        LINK &link  = *_spread._links[i];
+        NEURON neu2 = Get(link.Nid());
         StateRegister(neu2);
         // record activity on the link through aging
-        (*it).second.Aging();
+        link.Syn().Aging();
         // for temporary firing, qFiring==NIL;
         // for real firing, push excited neurons into queue
-        if (neu2.Excite(uShare) && qFiring) {
+        if (neu2.Excite(_spread._share[i]) && qFiring) {
             netPushFiringQueue ((*this), neu2.Id(), qFiring);
             bPropagated = true;
         }
         // register the firing pattern in temporary firing
         if (!qFiring) {
-            _bbs.Post(neu.Id(), neu2.Id(), (*it).second);
+            _bbs.Post(neu.Id(), neu2.Id(), link.Syn());
         }
     }
     return bPropagated;
 }
 
+// pick the links to propagate through, and split the energy;
+// in real firing (bFiring), only towards winners of the temporary
+// firing. Returns the number of links.
+unsigned NET::Spread(
+    NEURON     neu,
+    bool       bFiring,
+    bool       bDelay,
+    SPREAD    &sp)
+{
+    unsigned uTotal  = 0;
+    unsigned uEnergy = neu.Potential();
+    LINKS& mL=neu.Links();
+    LINKS::iterator it;
+    sp._links .clear();
+    sp._weight.clear();
+    foreachv (it, mL) {
+        if ((*it).Syn().Delayed()==bDelay && 
+            (!bFiring || _bbs.Exists((*it).Nid()))) {
+            sp._links .push_back(&(*it));
+            sp._weight.push_back((*it).Syn().Weight());
+            uTotal += (*it).Syn().Weight();
+        }
+    }
+    unsigned n = sp._links.size();
+    if (n) {
+        sp._share.resize(n);
+        ENERGY::Split (uEnergy, uTotal, &sp._weight[0], &sp._share[0], n);
+    }
+    return n;
+}
+
 // process the firing wave-front and wave-back queues
 bool NET::ProcessFiringQueue ()
 {
-    list<NID> * listTmp;
-    list<NID>::iterator it;
+    FRONT * listTmp;
+    unsigned i, uKeep=0;
     // remove neurons that have been filtered out during firing
-    it = _firingWavb->begin();
-    while (it!=_firingWavb->end()) {
+    foreach (i,0,_firingWavb->size()) {
+        NID id = (*_firingWavb)[i];
         // push fired neurons to current firing queue
-        if (_neurons[*it].FlagTest(NEURON::FLAG_FIRING)) {
-            _neurons[*it].FlagReset(NEURON::FLAG_FIRING);
-            netPushFiringQueue ((*this), *it, _firingCurr);
+        if (Neu(id).FlagTest(NEURON::FLAG_FIRING)) {
+            Neu(id).FlagReset(NEURON::FLAG_FIRING);
+            netPushFiringQueue ((*this), id, _firingCurr);
             // learned new concept; connect to output if still no link
-            ConnectOutput(*it);
+            ConnectOutput(id);
         }
         // 1. erase supressed neurons from wave-front queue;
-        if (!_neurons[*it].FlagTest(NEURON::FLAG_FIRING) || 
-             _neurons[*it].FlagTest(NEURON::FLAG_IGNITING)) {
-            it = _firingWavb->erase(it);
+        if (!Neu(id).FlagTest(NEURON::FLAG_FIRING) || 
+             Neu(id).FlagTest(NEURON::FLAG_IGNITING)) {
+            _firingWavb->Drop(id);
         } else {
-            it ++;
+            _firingWavb->Keep(uKeep++, id);
         }
         // 2. do not fire again if it has fired already.
         // If a neuron has fired and propagated its energy in this round
@@ -256,13 +393,14 @@ bool NET::ProcessFiringQueue ()
         // (This may not be a good way to break occilation, but for the
         //  timing being we do this as a workaround.)
     }
+    _firingWavb->Resize(uKeep);
     // - push valid firing to current queue;
     // Note : if it has propagated its energy to others, i.e.
     // with IGNITING flag, then do not push to firing queue.
     // This is to avoid being connected in the next round
     // unnecessarily.
     // for (it = _firingWavf->begin(); it!=_firingWavf->end(); it++) {
-    //     if (!_neurons[*it].FlagTest(NEURON::FLAG_IGNITING)) {
+    //     if (!Neu(*it).FlagTest(NEURON::FLAG_IGNITING)) {
     //     }
     // }
 
@@ -270,7 +408,7 @@ bool NET::ProcessFiringQueue ()
     listTmp     = _firingWavf;
     _firingWavf = _firingWavb;
     _firingWavb = listTmp;
-    _firingWavb->clear();
+    _firingWavb->Clear();
     // clear hash table for state reversal
     StateClear();
     return (!_firingWavf->empty());
@@ -282,7 +420,7 @@ void NET::RandomFire ()
     int i;
     _random.clear();
     foreach (i,0,RSIZE) {
-        NID id = rand()%(NSIZE-ISIZE) + ISIZE;
+        NID id = _rng.Below(NSIZE-ISIZE) + ISIZE;
         _random.push_back(id);
         netPushFiringQueue ((*this), id, _firingCurr);
         Get(id).Excite(NEURON::EXCITE_BASE);
@@ -305,24 +443,24 @@ void NET::RealFire (FIRING_TYPE type)
 void NET::Cool () 
 {
     // TODO: weaken links that are not excited (use DECAY)
-    int i;
-    list<NID> * listTmp;
-    list<NID>::iterator it;
+    unsigned i, uKeep=0;
+    FRONT * listTmp;
     // cool neurons from baking pan
-    it = _firingBake.begin();
-    while (it != _firingBake.end()) {
-        if (_neurons[*it].State() == NEURON::HYPER) {
+    foreach (i,0,_firingBake.size()) {
+        NID id = _firingBake[i];
+        if (Neu(id).State() == NEURON::HYPER) {
             // exlucde re-excited neurons
-            it = _firingBake.erase(it);
+            _firingBake.Drop(id);
         } else {
-            _neurons[*it].Cool();
-            if (_neurons[*it].State() == NEURON::QUIET) {
-                it = _firingBake.erase(it);
+            Neu(id).Cool();
+            if (Neu(id).State() == NEURON::QUIET) {
+                _firingBake.Drop(id);
             } else {
-                it++;
+                _firingBake.Keep(uKeep++, id);
             }
         }
     }
+    _firingBake.Resize(uKeep);
     
     // cool neurons in prio and current queues
     CoolPrioQueue ( );
@@ -333,12 +471,10 @@ void NET::Cool ()
     listTmp     = _firingPrio;
     _firingPrio = _firingCurr;
     _firingCurr = listTmp;
-    _firingCurr->clear();
+    _firingCurr->Clear();
     
     // cool input/output neurons also
-    foreach (i,0,ISIZE) {
-        _neurons[i].PotentialReset();
-    }
+    memset (_pool.Potent(), 0, sizeof(NEU_POTENT) * ISIZE);
 }
 
 
@@ -347,9 +483,36 @@ void NET::Cool ()
 // CURRENT : internal neurons in the current wave;
 // DELAYED : fire delayed links from prio-queue;
 
-void NET::ProcessFiring(FIRING_TYPE type, list<NID> *qFiring)
+void NET::ProcessFiring(FIRING_TYPE type, FRONT *qFiring)
 {
     bool bUpdated=false;
+    // real firing goes to the thread pool, if there is one
+    if (qFiring && _tpool) {
+        switch (type) {
+        case FIRING_INPUT   :
+            bUpdated = Fire (_inputs, ISIZE, qFiring);
+            break;
+        case FIRING_CURRENT :
+            bUpdated = Fire (_firingWavf->Data(), _firingWavf->size(),
+                             qFiring);
+            break;
+        case FIRING_DELAYED : {
+            _igniting.clear();
+            foreachl (it,_firingPrio) {
+                if (Neu(*it).FlagTest(NEURON::FLAG_IGNITING_P)) {
+                    _igniting.push_back(*it);
+                }
+            }
+            Fire (_igniting.empty() ? 0 : &_igniting[0],
+                  _igniting.size(), qFiring, true/*delayed*/);
+            return;
+        }
+        }
+        if (bUpdated) {
+            ProcessFiring (FIRING_DELAYED, qFiring);
+        }
+        return;
+    }
     switch (type) {
     case FIRING_INPUT   : {
         int i;
@@ -393,13 +556,13 @@ void NET::ProcessFiring(FIRING_TYPE type, list<NID> *qFiring)
 // transfer to baking pan
 void NET::CoolPrioQueue () 
 {
-    list<NID>::iterator it;
+    FRONT::iterator it;
     for (it=_firingPrio->begin(); it!=_firingPrio->end(); it++) {
         if (Get(*it).FlagTest(NEURON::FLAG_IGNITING_P)) {
             Get(*it).FlagReset(NEURON::FLAG_IGNITING_P);
         }
         // skip cooling if re-excited in the current round;
-        if (!_neurons[*it].FlagTest(NEURON::FLAG_FIRING) ) {
+        if (!Neu(*it).FlagTest(NEURON::FLAG_FIRING) ) {
             netPushBakingQueue((*this), *it, _firingBake);
         }
     }
@@ -408,38 +571,40 @@ void NET::CoolPrioQueue ()
 // cool the current firing neurons with competition
 void NET::CoolCurrQueue () 
 {
-    list<NID>::iterator it;
+    FRONT::iterator it;
+    unsigned i, uKeep=0;
     // remove neurons that have been filtered out
-    it = _firingCurr->begin();
-    while (it!=_firingCurr->end()) {
+    foreach (i,0,_firingCurr->size()) {
+        NID id = (*_firingCurr)[i];
         // change igniting state to igniting_p so that it has a chance
         // to fire in delayed mode in the next round.
-        if (_neurons[*it].FlagTest (NEURON::FLAG_IGNITING)) {
-            _neurons[*it].FlagReset(NEURON::FLAG_IGNITING);
-            _neurons[*it].FlagSet  (NEURON::FLAG_IGNITING_P);
+        if (Neu(id).FlagTest (NEURON::FLAG_IGNITING)) {
+            Neu(id).FlagReset(NEURON::FLAG_IGNITING);
+            Neu(id).FlagSet  (NEURON::FLAG_IGNITING_P);
         }
-        if (!_neurons[*it].FlagTest(NEURON::FLAG_FIRING)) {
-            netPushBakingQueue((*this), *it, _firingBake);
-            it = _firingCurr->erase(it);
+        if (!Neu(id).FlagTest(NEURON::FLAG_FIRING)) {
+            netPushBakingQueue((*this), id, _firingBake);
+            _firingCurr->Drop(id);
         } else {
-            it ++;
+            _firingCurr->Keep(uKeep++, id);
         }
     }
+    _firingCurr->Resize(uKeep);
     // for unique stamps, fittest survive.
     // first compare potential; then how to break tie?
     Sort (_firingCurr);
     while (_firingCurr->size() > MAX_FIRE) {
         // push incompetent ones to baking pan after cooling
         Get(_firingCurr->back()).Cool();
-        _firingBake.push_back(_firingCurr->back());
-        _firingCurr->pop_back();
+        _firingBake.Push(_firingCurr->back());
+        _firingCurr->PopBack();
     }
     // remove firing flag from current round; 
     // reduce potential to avoid dominance;
     // connect to output if it is a new concept
     for (it=_firingCurr->begin(); it!=_firingCurr->end(); it++) {
-        _neurons[*it].PotentialReduce();
-        _neurons[*it].FlagReset(NEURON::FLAG_FIRING);
+        Neu(*it).PotentialReduce();
+        Neu(*it).FlagReset(NEURON::FLAG_FIRING);
     }
 }
 
@@ -456,11 +621,12 @@ void NET::CoolOutput ()
 void NET::Report () 
 {
     int i, iFiring[5]={0,0,0,0,0};
+    const NEU_STATE *pState = _pool.State();
     foreach (i,ISIZE,NSIZE) {
-        iFiring[_neurons[i].State()] ++;
+        iFiring[(int)pState[i]] ++;
     }
     foreach (i,NSIZE,TSIZE) {
-        if (_neurons[i].State() != NEURON::QUIET) {
+        if (pState[i] != NEURON::QUIET) {
             iFiring[4] ++; // output
         }
     }
@@ -533,39 +699,51 @@ vector<NID>* NET::Levelize()
 void NET::ReportState (NEU_STATE st)
 {
     int i;
+    const NEU_STATE  *pState  = _pool.State();
+    const NEU_POTENT *pPotent = _pool.Potent();
     foreach (i,ISIZE,NSIZE) {
-        if (Get(i).State() == st) {
-            cout.width(3);cout<<Get(i).Id();
-            cout<<"("<<Get(i).Potential()<<") ";
+        if (pState[i] == st) {
+            cout.width(3);cout<<i;
+            cout<<"("<<pPotent[i]<<") ";
         }
     }
 }
 
 // register a neuron state
-void NET::StateRegister (NEURON &n)
+void NET::StateRegister (NEURON n)
 {
-    if (_record.find(n.Id()) == _record.end()) {
-        _record[n.Id()] = METASTATE(n);
+    UNDO &u = _undoAt[n.Id()];
+    if (u._epoch != _epoch) {
+        u._epoch = _epoch;
+        u._pos   = _undo.size();
+        _undo.push_back(pair<NID,METASTATE>(n.Id(),METASTATE(n)));
     }
 }
 
 // revert the neuron to a previous state
-void NET::StateRevert   (NEURON &n)
+void NET::StateRevert   (NEURON n)
 {
-    if (_record.find(n.Id()) != _record.end()) {
-        n.StateReset(_record[n.Id()]);
+    UNDO &u = _undoAt[n.Id()];
+    if (u._epoch == _epoch) {
+        n.StateReset(_undo[u._pos].second);
     }
 }
 
+// forget all registered states by moving to a new epoch
 void NET::StateClear   ()
 {
-    _record.clear();
+    _undo.clear();
+    if (++_epoch == 0) {
+        // epoch wrapped around; stale stamps could match again
+        memset (_undoAt, 0, sizeof(UNDO) * TSIZE);
+        _epoch = 1;
+    }
 }
 
 void NET::ConnectOutput(const NID nid)
 {
-    if (_neurons[nid].LinkCount()==0) {
-        _neurons[nid].Link(NextOutput());
+    if (Neu(nid).LinkCount()==0) {
+        Neu(nid).Link(NextOutput());
     }
 }
 
@@ -579,24 +757,19 @@ void netProcessUniquePattern (
     NET &net, 
     BBS &bbs) 
 {
-    NID    id;
-    STAMP *pst;
+    BBS::RESULT::iterator it;
     bbs.Select (net.Verbose() >= 2);
-    bbs.IterBegin (false); 
     // remove links attached to the losers;
-    while (bbs.IterNext(id)) {
+    foreachv (it, bbs.Losers()) {
+        NID id = (*it).first;
         net.StateRevert(net.Get(id));
-        if (bbs.GetStamp(id,pst)) {
-            netProcessStampLinks(net,(*pst),id,LINK_WEAKEN);
-        }
+        netProcessStampLinks(net,*(*it).second,id,LINK_WEAKEN);
     }
     // update STAMP for all fired neurons; then revert state
-    bbs.IterBegin (true); 
-    while (bbs.IterNext(id)) {
-        if (bbs.GetStamp(id,pst)) {
-            net.Get(id).Assign(pst);
-            netProcessStampLinks(net,(*pst),id,LINK_DEACTIVE);
-        }
+    foreachv (it, bbs.Winners()) {
+        NID id = (*it).first;
+        net.Get(id).Assign((*it).second);
+        netProcessStampLinks(net,*(*it).second,id,LINK_DEACTIVE);
         net.StateRevert(net.Get(id));
     }
     // remove losing NID from board completely, so that 
@@ -606,20 +779,20 @@ void netProcessUniquePattern (
     // bbs.Clear();
 }
 
-void netPushFiringQueue(NET &net, NID n, list<NID> *qFiring)
+void netPushFiringQueue(NET &net, NID n, FRONT *qFiring)
 {
-    NEURON &neu = net.Get(n);
+    NEURON neu = net.Get(n);
     if (neu.Type()!=OUTPUT && !neu.FlagTest(NEURON::FLAG_FIRING)) {
-        qFiring->push_back (n);
+        qFiring->Push (n);
         neu.FlagSet(NEURON::FLAG_FIRING);
     }
 }
 
-void netPushBakingQueue(NET &net, NID n, list<NID> &qBaking)
+void netPushBakingQueue(NET &net, NID n, FRONT &qBaking)
 {
     net.Get(n).Cool();
     if (net.Get(n).State() > NEURON::QUIET) {
-        qBaking.push_back(n);
+        qBaking.Push(n);
     }
 }
 
@@ -634,25 +807,23 @@ void netProcessStampLinks(
     NID       nDst,
     LINK_PROCESS_TYPE type)
 {
-    NID id;
-    vector<NID  >::iterator nit=pst.Nids().begin();
-    vector<SYNAP>::iterator sit=pst.Synaps().begin();
-    while (nit != pst.Nids().end()) {
+    NID   *nids = pst.Nids();
+    SYNAP *syns = pst.Synaps();
+    unsigned i;
+    foreach (i,0,pst.Size()) {
         bool f=false;
         if (type==LINK_WEAKEN) {
-            f=net.Get(*nit).LinkWeaken(nDst,(*sit).Delayed());
+            f=net.Get(nids[i]).LinkWeaken(nDst,syns[i].Delayed());
         } else if (type==LINK_DEACTIVE) {
-            f=net.Get(*nit).LinkDeactive(nDst,(*sit).Delayed());
+            f=net.Get(nids[i]).LinkDeactive(nDst,syns[i].Delayed());
         }
         assert (f);
-        nit++;
-        sit++;
     }
 }
 
 static int netGetNumLevels_rec(
     NET &n, 
-    NEURON &neu)
+    NEURON neu)
 {
     // skip already visited (or being processed) node
     if (neu.TravId() == n.TravId()) {
@@ -665,10 +836,10 @@ static int netGetNumLevels_rec(
     int i, iMax, iCur;
     iMax = -1;
     // traverse all links
-    map<NID,SYNAP>& mL=neu.Links();
-    map<NID,SYNAP>::iterator it;
+    LINKS& mL=neu.Links();
+    LINKS::iterator it;
     foreachv (it, mL) {
-        NEURON &neu2 = n.Get((*it).first);
+        NEURON neu2 = n.Get((*it).Nid());
         iCur = netGetNumLevels_rec(n,neu2);
         if (iMax < iCur) {
             iMax = iCur;
@@ -681,7 +852,7 @@ static int netGetNumLevels_rec(
 
 static void netLevelize_rec(
     NET &n, 
-    NEURON &neu,
+    NEURON neu,
     vector<NID> *vLevels)
 {
     // skip already visited (or being processed) node
@@ -691,10 +862,10 @@ static void netLevelize_rec(
     neu.TravId(n.TravId());
     
     // traverse all links; assuming level is already computed
-    map<NID,SYNAP>& mL=neu.Links();
-    map<NID,SYNAP>::iterator it;
+    LINKS& mL=neu.Links();
+    LINKS::iterator it;
     foreachv (it, mL) {
-        netLevelize_rec(n,n.Get((*it).first),vLevels);
+        netLevelize_rec(n,n.Get((*it).Nid()),vLevels);
     }
     if (neu.Type()!=INPUT || neu.LinkCount()>0) {
         assert (neu.Level() < vLevels->size());
@@ -705,10 +876,10 @@ static void netLevelize_rec(
 
 void netReportQueue (
     NET &n, 
-    list<NID> * q)
+    FRONT * q)
 {
     cout << " :QUEUE: ";
-    list<NID>::iterator it;
+    FRONT::iterator it;
     for (it=q->begin(); it!=q->end(); it++) {
         cout << (*it) << " ";
     }
@@ -5,11 +5,63 @@
 // Revision [$Id: ringNeuron.cpp,v 1.5 2008-04-27 00:22:01 wjiang Exp $]
 //
 
+#include <string.h>
 #include "ring.h"
+#include <algorithm>
 
 
 
 
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS NEUPOOL MEMBER FUNCTIONS
+//____________________________________________________________________
+NEUPOOL::NEUPOOL (NID size)
+    : _size   (size),
+      _potent (new NEU_POTENT [size]),
+      _state  (new NEU_STATE  [size]),
+      _flag   (new char       [size]),
+      _type   (new char       [size]),
+      _cells  (new NEUCELL    [size]),
+      _owned  (true),
+      _journal(0)
+{
+    memset (_potent, 0, sizeof(NEU_POTENT) * size);
+    memset (_state,  NEURON::QUIET,     sizeof(NEU_STATE) * size);
+    memset (_flag,   NEURON::FLAG_NONE, sizeof(char) * size);
+    memset (_type,   INTERNAL,          sizeof(char) * size);
+}
+
+NEUPOOL::~NEUPOOL ()
+{
+    if (_owned) {
+        delete [] _potent;
+        delete [] _state;
+        delete [] _flag;
+        delete [] _type;
+    }
+    delete [] _cells;
+}
+
+void NEUPOOL::Attach(
+    NEU_POTENT *potent,
+    NEU_STATE  *state,
+    char       *flag,
+    char       *type)
+{
+    if (_owned) {
+        delete [] _potent;
+        delete [] _state;
+        delete [] _flag;
+        delete [] _type;
+    }
+    _potent = potent;
+    _state  = state;
+    _flag   = flag;
+    _type   = type;
+    _owned  = false;
+}
+
+
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // CLASS NEURON  MEMBER FUNCTIONS
 //____________________________________________________________________
@@ -18,8 +70,8 @@
 // make links to target neurons 
 
 void NET::Connect(
-    NEURON     &neu, 
-    list<NID> *qTargets, 
+    NEURON      neu, 
+    FRONT     *qTargets, 
     bool       bDelay) 
 {
     // competition: 
@@ -31,33 +83,81 @@ void NET::Connect(
     if (neu.Type() == OUTPUT) {
         return;
     }
-    list<NID>::iterator it;
+    // avoid direct loop : if A->B, then B cannot link to A;
+    // mark the neurons linking to this one, and itself (self-loop)
+    if (++_markStamp == 0) {
+        fill (_mark.begin(), _mark.end(), 0);
+        _markStamp = 1;
+    }
+    LINKS::iterator lit;
+    foreachv (lit, neu.InLinks()) {
+        _mark[(*lit).Nid()] = _markStamp;
+    }
+    _mark[neu.Id()] = _markStamp;
+    // the remaining targets are linked or strengthened in one batch
+    _targets.clear();
+    FRONT::iterator it;
     for (it=qTargets->begin(); it!=qTargets->end(); it++) {
-        // avoid self-loop
-        if ((*it) == neu.Id()) {
-            continue;
+        if (_mark[*it] != _markStamp) {
+            _targets.push_back(*it);
         }
-        // avoid direct loop :
-        // if A->B, then B cannot link to A
-        if (Get(*it).Linked(neu.Id())) {
-            continue;
-        }
-        neu.Link(*it, bDelay);
     }
+    if (_targets.empty()) {
+        return;
+    }
+    sort (_targets.begin(), _targets.end());
+    neu.LinkBatch(&_targets[0], _targets.size(), bDelay);
 }
 
 // connect or strengthen with given neuron
 
 void NEURON::Link(NID nid, bool bDelay) 
 {
-    map<NID,SYNAP>::iterator itConn;
-    if ((itConn=_links.find(nid)) == _links.end()) {
+    if (_pool->_journal) {
+        _pool->_journal->Link(_id,nid,bDelay);
+    }
+    LINK *pConn;
+    if ((pConn=Links().Find(nid)) == 0) {
         // make link if not already
-        _links.insert(pair<NID,SYNAP>(nid,SYNAP(bDelay)));
+        Links().Insert(nid,SYNAP(bDelay));
+        InLink(nid);
     } else {
         // strengthened based if delay flag matches
-        if ((*itConn).second.Delayed() == bDelay) {
-            (*itConn).second.Strengthen();
+        if (pConn->Syn().Delayed() == bDelay) {
+            pConn->Syn().Strengthen();
+        }
+    }
+}
+
+// same as Link for each target, walking the sorted links once;
+// targets without any slot are collected and merged in at the end
+void NEURON::LinkBatch(NID *nids, unsigned n, bool bDelay)
+{
+    LINKS &mL = Links();
+    LINK  *p  = mL.Data();
+    LINK  *e  = p + mL.Slots();
+    unsigned i, uNew=0;
+    foreach (i,0,n) {
+        if (_pool->_journal) {
+            _pool->_journal->Link(_id,nids[i],bDelay);
+        }
+        while (p!=e && p->Nid() < nids[i]) {
+            p++;
+        }
+        if (p==e || p->Nid()!=nids[i]) {
+            nids[uNew++] = nids[i];
+        } else if (p->Dead()) {
+            // revive the tombstone in place
+            mL.Insert(nids[i],SYNAP(bDelay));
+            InLink(nids[i]);
+        } else if (p->Syn().Delayed() == bDelay) {
+            p->Syn().Strengthen();
+        }
+    }
+    if (uNew) {
+        mL.Merge(nids, uNew, SYNAP(bDelay));
+        foreach (i,0,uNew) {
+            InLink(nids[i]);
         }
     }
 }
@@ -65,9 +165,9 @@ void NEURON::Link(NID nid, bool bDelay)
 // reset neuron state based on previous recording
 void NEURON::StateReset(METASTATE s)
 {
-    _flag  =s.u.s._flag; 
-    _state =s.u.s._state; 
-    _potent=s.u.s._potent;
+    Flag()  =s.u.s._flag; 
+    State    (s.u.s._state); 
+    Potent()=s.u.s._potent;
 }
 
 
@@ -77,11 +177,11 @@ void NEURON::Cool()
 {
     PotentialReduce();
     FlagReset(FLAG_FIRING);
-    switch (_state) {
+    switch (State()) {
     case QUIET:   break;
-    case AWAKE:   _state = QUIET; _potent=0; break;
-    case MELLOW:  _state = AWAKE;  break;
-    case HYPER:   _state = MELLOW; break;
+    case AWAKE:   State(QUIET); Potent()=0; break;
+    case MELLOW:  State(AWAKE);  break;
+    case HYPER:   State(MELLOW); break;
     default:      break;
     }
 }
@@ -90,14 +190,14 @@ void NEURON::Cool()
 // reset potential to zero
 void NEURON::PotentialReset()
 {
-    _potent = 0;
+    Potent() = 0;
 }
 
 
 // linearly reduce potential
 void NEURON::PotentialReduce()
 {
-    _potent /= 2;
+    Potent() /= 2;
     //float ratio = ((float)(_state - QUIET))/((float)(_state + 1));
     //_potent =  (int) (ratio * (float)_potent);
 }
@@ -108,10 +208,10 @@ void NEURON::PotentialReduce()
 bool NEURON::Excite(NEU_POTENT pot)
 {
     PotentialAdd(pot);
-    if (Potential() > THRESH_BASE && _state != HYPER ) {
-        _state = HYPER;
+    if (Potential() > THRESH_BASE && State() != HYPER ) {
+        State(HYPER);
     }
-    return (_state == HYPER);
+    return (State() == HYPER);
 }
 
 
@@ -120,11 +220,14 @@ bool NEURON::Excite(NEU_POTENT pot)
 bool NEURON::LinkRemove(NID id)
 {
     bool fResult = false;
-    map<NID,SYNAP>::iterator itConn;
-    if ((itConn=_links.find(id)) != _links.end()) {
+    LINK *pConn;
+    if ((pConn=Links().Find(id)) != 0) {
         fResult = true;
-        _links.erase(itConn);
-        //_links.erase(id); // extra runtime to find item
+        if (_pool->_journal) {
+            _pool->_journal->Remove(_id,id);
+        }
+        Links().Erase(pConn);
+        InUnlink(id);
     }
     return fResult;
 }
@@ -134,14 +237,18 @@ bool NEURON::LinkRemove(NID id)
 bool NEURON::LinkWeaken(NID id, bool bDelayed)
 {
     bool fResult = false;
-    map<NID,SYNAP>::iterator itConn;
-    if ((itConn=_links.find(id)) != _links.end()) {
+    LINK *pConn;
+    if ((pConn=Links().Find(id)) != 0) {
         fResult = true;
-        if ((*itConn).second.Active() &&
-            (*itConn).second.Delayed() == bDelayed) {
-            (*itConn).second.Weaken();
-            if ((*itConn).second.Weight() == 0) {
-                _links.erase(itConn);
+        if (pConn->Syn().Active() &&
+            pConn->Syn().Delayed() == bDelayed) {
+            if (_pool->_journal) {
+                _pool->_journal->Weaken(_id,id,bDelayed);
+            }
+            pConn->Syn().Weaken();
+            if (pConn->Syn().Weight() == 0) {
+                Links().Erase(pConn);
+                InUnlink(id);
             }
         }
     }
@@ -151,12 +258,15 @@ bool NEURON::LinkWeaken(NID id, bool bDelayed)
 bool NEURON::LinkDeactive(NID id, bool bDelayed)
 {
     bool fResult = false;
-    map<NID,SYNAP>::iterator itConn;
-    if ((itConn=_links.find(id)) != _links.end()) {
+    LINK *pConn;
+    if ((pConn=Links().Find(id)) != 0) {
         fResult = true;
-        if ((*itConn).second.Active() &&
-            (*itConn).second.Delayed() == bDelayed) {
-            (*itConn).second.Deactive();
+        if (pConn->Syn().Active() &&
+            pConn->Syn().Delayed() == bDelayed) {
+            if (_pool->_journal) {
+                _pool->_journal->Deactive(_id,id,bDelayed);
+            }
+            pConn->Syn().Deactive();
         }
     }
     return fResult;
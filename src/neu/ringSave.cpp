@@ -0,0 +1,442 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : ringSave.cpp
+//
+// DESCRIPTION :
+//    Binary snapshots of a NET, so training can stop and resume
+//    without running the whole input again.
+//
+//    File layout (little-endian, version 1):
+//      header   magic "RINGSNAP", version, section count, ISIZE, TSIZE
+//      table    one entry per section: id, offset, length in bytes
+//      sections each starting at a multiple of 64 bytes
+//
+//    The edges are kept in CSR form, with each neuron's row padded
+//    to a power of two; the rows are exactly the SLAB segments the
+//    links live in, so Load maps the file (MAP_PRIVATE) and points
+//    the hot arrays and link arrays into it without copying.  Only
+//    signatures, queues and the in-link index are rebuilt.
+//
+//    Everything that steers the next Update is saved, so a resumed
+//    run matches an uninterrupted one; scratch and undo state is
+//    empty between Updates and is not.
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ring.h"
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// SNAPSHOT FORMAT
+//____________________________________________________________________
+static const char     chSnapMagic[8] = {'R','I','N','G','S','N','A','P'};
+static const uint32_t uSnapVersion   = 1;
+static const uint64_t uSnapAlign     = 64;
+
+// section ids; readers skip ids they do not know
+enum SNAP_ID {
+    SNAP_POTENT = 1,   // NEU_POTENT [TSIZE]
+    SNAP_STATE,        // NEU_STATE  [TSIZE]
+    SNAP_FLAG,         // char       [TSIZE]
+    SNAP_TYPE,         // char       [TSIZE]
+    SNAP_EDGEOFF,      // uint32 [TSIZE+1] row bounds, in links
+    SNAP_EDGELEN,      // uint32 [TSIZE]   live links of each row
+    SNAP_EDGE,         // LINK   [] nid (32 bits), synapse (32 bits)
+    SNAP_SIGNOFF,      // uint32 [TSIZE+1] signature bounds, in keys
+    SNAP_SIGN,         // uint32 [] signature keys
+    SNAP_QUEUE,        // uint32 [5] lengths; then the NIDs of
+                       // prio, curr, wave front, wave back, bake
+    SNAP_SCALAR,       // uint64 [4] next output, time, rng key/count
+    SNAP_LAST
+};
+static const unsigned uSnapQueues  = 5;
+static const unsigned uSnapScalars = 4;
+
+struct SNAPHEAD
+{
+    char     _magic[8];
+    uint32_t _version;
+    uint32_t _sections;
+    uint32_t _isize;
+    uint32_t _tsize;
+};
+
+struct SNAPSEC
+{
+    uint32_t _id;
+    uint32_t _pad;
+    uint64_t _offset;
+    uint64_t _bytes;
+};
+
+// sections of a mapped snapshot, by id
+struct SNAPVIEW
+{
+    char     * _sec  [SNAP_LAST];
+    uint64_t   _bytes[SNAP_LAST];
+};
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STATIC FUNCTIONS DEFINED IN THIS FILE
+//____________________________________________________________________
+
+// the format is little-endian and links are stored as they sit in
+// memory: nid, then the SYNAP bit-fields from the lowest bit
+// (weight:8, active:1, delayed:1, age:11, decay:11)
+static bool sSnapHost ()
+{
+    uint32_t u = 1;
+    if (*(char *)&u != 1 || sizeof(LINK) != 8) {
+        return false;
+    }
+    LINK link (3, SYNAP(5u,true,7));
+    uint32_t w[2];
+    memcpy (w, &link, sizeof(w));
+    return w[0]==3 && w[1]==(5u | (1u<<8) | (1u<<9) | (7u<<10));
+}
+
+// capacity of the SLAB segment holding n links
+static unsigned sSnapSegment (unsigned n)
+{
+    if (n == 0) {
+        return 0;
+    }
+    unsigned cap = 2;
+    while (cap < n) {
+        cap *= 2;
+    }
+    return cap;
+}
+
+static uint64_t sSnapAlignUp (uint64_t n)
+{
+    return (n + uSnapAlign-1) & ~(uSnapAlign-1);
+}
+
+static void sSnapAdd (
+    vector<SNAPSEC>      &vSec,
+    vector<const void *> &vData,
+    uint32_t              id,
+    const void           *data,
+    uint64_t              bytes)
+{
+    SNAPSEC sec;
+    sec._id     = id;
+    sec._pad    = 0;
+    sec._offset = 0;
+    sec._bytes  = bytes;
+    vSec.push_back(sec);
+    vData.push_back(data);
+}
+
+// locate the sections and check them against a net of the given
+// size; return an error message, NIL if the snapshot is sound
+static const char * sSnapCheck (
+    char     *base,
+    uint64_t  size,
+    NID       isize,
+    NID       tsize,
+    NID       osize,
+    SNAPVIEW &v)
+{
+    unsigned i;
+    foreach (i,0,SNAP_LAST) {
+        v._sec[i]   = 0;
+        v._bytes[i] = 0;
+    }
+    SNAPHEAD head;
+    if (size < sizeof(head)) {
+        return "not a snapshot";
+    }
+    memcpy (&head, base, sizeof(head));
+    if (memcmp(head._magic, chSnapMagic, sizeof(chSnapMagic)) != 0) {
+        return "not a snapshot";
+    }
+    if (head._version != uSnapVersion) {
+        return "unsupported snapshot version";
+    }
+    if (head._isize != isize || head._tsize != tsize) {
+        return "snapshot is for a net of another size";
+    }
+    if (head._sections > (size-sizeof(head)) / sizeof(SNAPSEC)) {
+        return "truncated section table";
+    }
+    const SNAPSEC *pSec = (const SNAPSEC *)(base + sizeof(head));
+    foreach (i,0,head._sections) {
+        SNAPSEC sec;
+        memcpy (&sec, pSec+i, sizeof(sec));
+        if (sec._offset > size || sec._bytes > size-sec._offset ||
+            sec._offset % 8 != 0) {
+            return "section out of bounds";
+        }
+        if (sec._id == 0 || sec._id >= SNAP_LAST) {
+            continue;
+        }
+        if (v._sec[sec._id]) {
+            return "duplicate section";
+        }
+        v._sec  [sec._id] = base + sec._offset;
+        v._bytes[sec._id] = sec._bytes;
+    }
+    // fixed-size sections
+    const uint64_t uFixed[SNAP_LAST] = { 0,
+        sizeof(NEU_POTENT)*tsize, sizeof(NEU_STATE)*tsize, tsize, tsize,
+        4*(uint64_t)(tsize+1), 4*(uint64_t)tsize, 0,
+        4*(uint64_t)(tsize+1), 0, 0, 8*uSnapScalars };
+    foreach (i,1,SNAP_LAST) {
+        if (!v._sec[i]) {
+            return "missing section";
+        }
+        if (uFixed[i] && v._bytes[i] != uFixed[i]) {
+            return "section of wrong size";
+        }
+    }
+    // edges: rows are power-of-two segments of sorted live links
+    const uint32_t *pOff = (const uint32_t *)v._sec[SNAP_EDGEOFF];
+    const uint32_t *pLen = (const uint32_t *)v._sec[SNAP_EDGELEN];
+    LINK           *pEdge= (LINK *)v._sec[SNAP_EDGE];
+    if (v._bytes[SNAP_EDGE] % sizeof(LINK) != 0 || pOff[0] != 0 ||
+        pOff[tsize] != v._bytes[SNAP_EDGE] / sizeof(LINK)) {
+        return "bad edge index";
+    }
+    foreach (i,0,tsize) {
+        if (pOff[i+1] < pOff[i]) {
+            return "bad edge index";
+        }
+        unsigned cap = pOff[i+1] - pOff[i];
+        if (pLen[i] > cap || (cap && (cap < 2 || (cap & (cap-1))))) {
+            return "bad edge index";
+        }
+        unsigned k;
+        foreach (k,0,pLen[i]) {
+            LINK &link = pEdge[pOff[i]+k];
+            if (link.Nid() >= tsize || link.Dead() ||
+                (k && link.Nid() <= pEdge[pOff[i]+k-1].Nid())) {
+                return "bad edge";
+            }
+        }
+    }
+    // signatures
+    pOff = (const uint32_t *)v._sec[SNAP_SIGNOFF];
+    if (v._bytes[SNAP_SIGN] % 4 != 0 || pOff[0] != 0 ||
+        pOff[tsize] != v._bytes[SNAP_SIGN] / 4) {
+        return "bad signature index";
+    }
+    foreach (i,0,tsize) {
+        if (pOff[i+1] < pOff[i]) {
+            return "bad signature index";
+        }
+    }
+    // queues
+    const uint32_t *pQueue = (const uint32_t *)v._sec[SNAP_QUEUE];
+    uint64_t uNids = 0;
+    if (v._bytes[SNAP_QUEUE] < 4*uSnapQueues) {
+        return "bad queue section";
+    }
+    foreach (i,0,uSnapQueues) {
+        uNids += pQueue[i];
+    }
+    if (v._bytes[SNAP_QUEUE] != 4*(uSnapQueues+uNids)) {
+        return "bad queue section";
+    }
+    foreach (i,0,uNids) {
+        if (pQueue[uSnapQueues+i] >= tsize) {
+            return "bad queue section";
+        }
+    }
+    uint64_t uScalar[uSnapScalars];
+    memcpy (uScalar, v._sec[SNAP_SCALAR], sizeof(uScalar));
+    if (uScalar[0] > osize) {
+        return "bad next output";
+    }
+    return 0;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS NET  MEMBER FUNCTIONS
+//____________________________________________________________________
+
+// write the learning state; call between Updates
+bool NET::Save (const char *chFileName)
+{
+    if (!sSnapHost()) {
+        cerr << "ERROR: snapshots are not supported on this host" << endl;
+        return false;
+    }
+    NEUCELL *pCells = _pool.Cells();
+    vector<uint32_t> vEdgeOff(TSIZE+1), vEdgeLen(TSIZE), vSignOff(TSIZE+1);
+    vector<LINK>     vEdges;
+    vector<uint32_t> vKeys;
+    NID i;
+    // live links only: tombstones are squeezed out on the way
+    foreach (i,0,TSIZE) {
+        LINKS &links = pCells[i].Links();
+        SIGN  &sign  = pCells[i].Sign();
+        LINKS::iterator it;
+        vEdgeOff[i] = vEdges.size();
+        vEdgeLen[i] = links.size();
+        foreachv (it, links) {
+            vEdges.push_back(*it);
+        }
+        vEdges.resize(vEdgeOff[i] + sSnapSegment(links.size()),
+                      LINK(0,SYNAP(0u)));
+        vSignOff[i] = vKeys.size();
+        vKeys.insert(vKeys.end(), sign.Keys(), sign.Keys()+sign.NumKeys());
+    }
+    vEdgeOff[TSIZE] = vEdges.size();
+    vSignOff[TSIZE] = vKeys.size();
+
+    FRONT *pQueues[uSnapQueues] = {
+        _firingPrio, _firingCurr, _firingWavf, _firingWavb, &_firingBake };
+    vector<uint32_t> vQueue;
+    unsigned q;
+    foreach (q,0,uSnapQueues) {
+        vQueue.push_back(pQueues[q]->size());
+    }
+    foreach (q,0,uSnapQueues) {
+        vQueue.insert(vQueue.end(), pQueues[q]->begin(), pQueues[q]->end());
+    }
+    uint64_t uScalar[uSnapScalars] = {
+        _nextOutput, (uint64_t)(int64_t)_time, _rng.Key(), _rng.Count() };
+
+    vector<SNAPSEC>      vSec;
+    vector<const void *> vData;
+    sSnapAdd (vSec,vData,SNAP_POTENT, _pool.Potent(),
+              sizeof(NEU_POTENT)*TSIZE);
+    sSnapAdd (vSec,vData,SNAP_STATE,  _pool.State(), sizeof(NEU_STATE)*TSIZE);
+    sSnapAdd (vSec,vData,SNAP_FLAG,   _pool.Flag(),  TSIZE);
+    sSnapAdd (vSec,vData,SNAP_TYPE,   _pool.Type(),  TSIZE);
+    sSnapAdd (vSec,vData,SNAP_EDGEOFF,&vEdgeOff[0],  4*vEdgeOff.size());
+    sSnapAdd (vSec,vData,SNAP_EDGELEN,&vEdgeLen[0],  4*vEdgeLen.size());
+    sSnapAdd (vSec,vData,SNAP_EDGE,   vEdges.empty() ? 0 : &vEdges[0],
+              sizeof(LINK)*vEdges.size());
+    sSnapAdd (vSec,vData,SNAP_SIGNOFF,&vSignOff[0],  4*vSignOff.size());
+    sSnapAdd (vSec,vData,SNAP_SIGN,   vKeys.empty() ? 0 : &vKeys[0],
+              4*vKeys.size());
+    sSnapAdd (vSec,vData,SNAP_QUEUE,  &vQueue[0],    4*vQueue.size());
+    sSnapAdd (vSec,vData,SNAP_SCALAR, uScalar,       sizeof(uScalar));
+
+    SNAPHEAD head;
+    memcpy (head._magic, chSnapMagic, sizeof(chSnapMagic));
+    head._version  = uSnapVersion;
+    head._sections = vSec.size();
+    head._isize    = ISIZE;
+    head._tsize    = TSIZE;
+    uint64_t uPos = sizeof(head) + sizeof(SNAPSEC)*vSec.size();
+    foreach (q,0,vSec.size()) {
+        vSec[q]._offset = uPos = sSnapAlignUp(uPos);
+        uPos += vSec[q]._bytes;
+    }
+
+    ofstream out (chFileName, ios::out|ios::binary|ios::trunc);
+    if (!out.is_open()) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be opened!" << endl;
+        return false;
+    }
+    static const char chZero[uSnapAlign] = {0};
+    out.write ((const char *)&head, sizeof(head));
+    out.write ((const char *)&vSec[0], sizeof(SNAPSEC)*vSec.size());
+    uPos = sizeof(head) + sizeof(SNAPSEC)*vSec.size();
+    foreach (q,0,vSec.size()) {
+        out.write (chZero, vSec[q]._offset - uPos);
+        out.write ((const char *)vData[q], vSec[q]._bytes);
+        uPos = vSec[q]._offset + vSec[q]._bytes;
+    }
+    out.close();
+    if (out.fail()) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be written!" << endl;
+        return false;
+    }
+    return true;
+}
+
+// resume from a snapshot written by Save
+bool NET::Load (const char *chFileName)
+{
+    if (_snap) {
+        cerr << "ERROR: net already holds a snapshot" << endl;
+        return false;
+    }
+    if (!sSnapHost()) {
+        cerr << "ERROR: snapshots are not supported on this host" << endl;
+        return false;
+    }
+    int fd = open (chFileName, O_RDONLY);
+    if (fd < 0) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be opened!" << endl;
+        return false;
+    }
+    // private mapping: pages are copied only once the net writes them
+    struct stat st;
+    void *pMap = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        pMap = mmap (0, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close (fd);
+    if (pMap == MAP_FAILED) {
+        cerr << "ERROR: file "<<chFileName<<" cannot be mapped!" << endl;
+        return false;
+    }
+    SNAPVIEW v;
+    const char *chErr = sSnapCheck ((char *)pMap, st.st_size,
+                                    ISIZE, TSIZE, OSIZE, v);
+    if (chErr) {
+        cerr << "ERROR: "<<chFileName<<": "<<chErr << endl;
+        munmap (pMap, st.st_size);
+        return false;
+    }
+    _snap     = pMap;
+    _snapSize = st.st_size;
+
+    // hot arrays and link rows are used in place
+    _pool.Attach ((NEU_POTENT *)v._sec[SNAP_POTENT],
+                  (NEU_STATE  *)v._sec[SNAP_STATE],
+                  v._sec[SNAP_FLAG], v._sec[SNAP_TYPE]);
+    NEUCELL        *pCells = _pool.Cells();
+    const uint32_t *pOff   = (const uint32_t *)v._sec[SNAP_EDGEOFF];
+    const uint32_t *pLen   = (const uint32_t *)v._sec[SNAP_EDGELEN];
+    const uint32_t *pSOff  = (const uint32_t *)v._sec[SNAP_SIGNOFF];
+    const uint32_t *pKeys  = (const uint32_t *)v._sec[SNAP_SIGN];
+    LINK           *pEdge  = (LINK *)v._sec[SNAP_EDGE];
+    NID i;
+    foreach (i,0,TSIZE) {
+        pCells[i].Links().Attach(pEdge+pOff[i], pLen[i], pOff[i+1]-pOff[i]);
+        pCells[i].InLinks().Attach(0, 0, 0);
+        pCells[i].Sign().Assign(pKeys+pSOff[i], pSOff[i+1]-pSOff[i]);
+    }
+    // in-link index: sources come in ascending order, so each
+    // insertion appends
+    foreach (i,0,TSIZE) {
+        LINKS::iterator it;
+        foreachv (it, pCells[i].Links()) {
+            pCells[(*it).Nid()].InLinks().Insert(i, SYNAP(1u));
+        }
+    }
+    FRONT *pQueues[uSnapQueues] = {
+        _firingPrio, _firingCurr, _firingWavf, _firingWavb, &_firingBake };
+    const uint32_t *pQueue = (const uint32_t *)v._sec[SNAP_QUEUE];
+    const uint32_t *pNids  = pQueue + uSnapQueues;
+    unsigned q, k;
+    foreach (q,0,uSnapQueues) {
+        pQueues[q]->Clear();
+        foreach (k,0,pQueue[q]) {
+            pQueues[q]->Push(*pNids++);
+        }
+    }
+    uint64_t uScalar[uSnapScalars];
+    memcpy (uScalar, v._sec[SNAP_SCALAR], sizeof(uScalar));
+    _nextOutput = uScalar[0];
+    _time       = (long)(int64_t)uScalar[1];
+    _rng.Restore (uScalar[2], uScalar[3]);
+    _bbs.Clear();
+    StateClear();
+    InputScan();
+    return true;
+}
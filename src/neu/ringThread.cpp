@@ -0,0 +1,702 @@
+// RING : Real Intelligence Neural-net
+//
+// Copyright @ Yunjian Jiang (William) 2008
+//
+// FILE : ringThread.cpp
+//
+// DESCRIPTION :
+//    Parallel real firing, in phases over a pool of threads: the
+//    total weight per source and the energy split are taken from
+//    the state before the firing, and each link fired through is
+//    filed with the worker that owns its target (a block of NIDs).
+//    Each worker then puts the links into its targets in slot order,
+//    which is the order of the sequential path, and excites them;
+//    the links are aged in parallel as well.
+//
+//    A neuron excited by an earlier one in the same firing may fire
+//    otherwise at its turn; only those few are gone through serially
+//    (FireResolve), with the energy split again from their potential
+//    at that point, so the result is the one of Propagate for any
+//    thread count.
+//
+//    Fan-out is very skewed (a few neurons hold up to MAX_SYNAP links),
+//    so work is scheduled over links rather than neurons: the link
+//    slots of all sources are laid end to end, and ranges of that
+//    space are handed out by work stealing (STEAL).
+
+#include "ring.h"
+#include <algorithm>
+#include <sched.h>
+#include <sys/time.h>
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STATIC FUNCTIONS DEFINED IN THIS FILE
+//____________________________________________________________________
+
+// the worker that excites a target: one block of NIDs each
+static inline unsigned sOwner (NID t, unsigned workers, NID size)
+{
+    return (unsigned)((uint64_t)t * workers / size);
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - TPOOL
+//____________________________________________________________________
+TPOOL::TPOOL (unsigned size)
+    : _size(size ? size : 1),_task(0),_round(0),_busy(0),_quit(false)
+{
+    pthread_mutex_init (&_mutex, 0);
+    pthread_cond_init  (&_start, 0);
+    pthread_cond_init  (&_done,  0);
+    // worker 0 is the calling thread
+    _args.resize(_size);
+    _threads.resize(_size);
+    unsigned i;
+    foreach (i,1,_size) {
+        _args[i]._pool   = this;
+        _args[i]._worker = i;
+        pthread_create (&_threads[i], 0, Main, &_args[i]);
+    }
+}
+
+TPOOL::~TPOOL ()
+{
+    pthread_mutex_lock   (&_mutex);
+    _quit = true;
+    pthread_cond_broadcast (&_start);
+    pthread_mutex_unlock (&_mutex);
+    unsigned i;
+    foreach (i,1,_size) {
+        pthread_join (_threads[i], 0);
+    }
+    pthread_cond_destroy  (&_done);
+    pthread_cond_destroy  (&_start);
+    pthread_mutex_destroy (&_mutex);
+}
+
+void * TPOOL::Main (void *arg)
+{
+    ARG *a = (ARG *)arg;
+    a->_pool->Loop(a->_worker);
+    return 0;
+}
+
+void TPOOL::Loop (unsigned worker)
+{
+    unsigned uSeen = 0;
+    while (true) {
+        pthread_mutex_lock (&_mutex);
+        while (!_quit && _round == uSeen) {
+            pthread_cond_wait (&_start, &_mutex);
+        }
+        if (_quit) {
+            pthread_mutex_unlock (&_mutex);
+            return;
+        }
+        uSeen = _round;
+        TASK *task = _task;
+        pthread_mutex_unlock (&_mutex);
+
+        task->Work(worker);
+
+        pthread_mutex_lock (&_mutex);
+        if (--_busy == 0) {
+            pthread_cond_signal (&_done);
+        }
+        pthread_mutex_unlock (&_mutex);
+    }
+}
+
+void TPOOL::Run (TASK *task)
+{
+    if (_size == 1) {
+        task->Work(0);
+        return;
+    }
+    pthread_mutex_lock (&_mutex);
+    _task = task;
+    _busy = _size-1;
+    _round++;
+    pthread_cond_broadcast (&_start);
+    pthread_mutex_unlock (&_mutex);
+
+    task->Work(0);
+
+    pthread_mutex_lock (&_mutex);
+    while (_busy > 0) {
+        pthread_cond_wait (&_done, &_mutex);
+    }
+    _task = 0;
+    pthread_mutex_unlock (&_mutex);
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - STEAL
+//____________________________________________________________________
+static inline void sLock   (volatile int *l)
+{
+    while (__sync_lock_test_and_set(l, 1)) {
+        while (__atomic_load_n(l, __ATOMIC_RELAXED)) { }
+    }
+}
+static inline void sUnlock (volatile int *l)
+{
+    __sync_lock_release(l);
+}
+
+void STEAL::Run (unsigned n)
+{
+    if (n == 0) {
+        return;
+    }
+    unsigned w, size = _pool.Size();
+    _deques.resize(size);
+    foreach (w,0,size) {
+        RANGE r;
+        r._beg = (unsigned)((uint64_t)n * w     / size);
+        r._end = (unsigned)((uint64_t)n * (w+1) / size);
+        _deques[w]._ranges.clear();
+        if (r._beg < r._end) {
+            _deques[w]._ranges.push_back(r);
+        }
+    }
+    _left = n;
+    __sync_synchronize();
+    _pool.Run(this);
+}
+
+void STEAL::Work (unsigned w)
+{
+    RANGE r;
+    while (__atomic_load_n(&_left, __ATOMIC_ACQUIRE) > 0) {
+        if (!Pop(w, r) && !Steal(w, r)) {
+            sched_yield();
+            continue;
+        }
+        // split down to the grain; others may take the upper halves
+        while (r._end - r._beg > _grain) {
+            RANGE h;
+            h._beg = r._beg + (r._end - r._beg)/2;
+            h._end = r._end;
+            r._end = h._beg;
+            Push(w, h);
+        }
+        Range(w, r._beg, r._end);
+        __sync_fetch_and_sub(&_left, r._end - r._beg);
+    }
+}
+
+void STEAL::Push (unsigned w, RANGE r)
+{
+    DEQUE &d = _deques[w];
+    sLock  (&d._lock);
+    d._ranges.push_back(r);
+    sUnlock(&d._lock);
+}
+
+// the owner takes the newest range, the smallest one
+bool STEAL::Pop (unsigned w, RANGE &r)
+{
+    DEQUE &d = _deques[w];
+    bool bFound = false;
+    sLock  (&d._lock);
+    if (!d._ranges.empty()) {
+        r = d._ranges.back();
+        d._ranges.pop_back();
+        bFound = true;
+    }
+    sUnlock(&d._lock);
+    return bFound;
+}
+
+// a thief takes the oldest range of the next busy worker
+bool STEAL::Steal (unsigned w, RANGE &r)
+{
+    unsigned i, size = _deques.size();
+    foreach (i,1,size) {
+        DEQUE &d = _deques[(w+i) % size];
+        bool bFound = false;
+        sLock  (&d._lock);
+        if (!d._ranges.empty()) {
+            r = d._ranges.front();
+            d._ranges.pop_front();
+            bFound = true;
+        }
+        sUnlock(&d._lock);
+        if (bFound) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - FIRESTEAL, FIREPART
+//____________________________________________________________________
+
+// one phase of a firing over the link space: the total weight per
+// source, the energy split, or the ageing of the links fired through
+class FIRESTEAL : public STEAL
+{
+ public:
+    enum PHASE { TOTAL, SPLIT, AGE };
+    static const unsigned iGrain = 128;  // links per smallest range
+    FIRESTEAL (NET &net, bool d, PHASE p)
+        : STEAL(*net._tpool, iGrain),_net(net),_delay(d),_phase(p) {}
+    void Range (unsigned worker, unsigned beg, unsigned end) {
+        switch (_phase) {
+        case TOTAL:
+            _net.FireTotal (worker, beg, end, _delay);
+            break;
+        case SPLIT:
+            _net.FireSplit (_net._bufs[worker]._spread, beg, end, _delay);
+            break;
+        case AGE:
+            _net.FireAge (beg, end);
+            break;
+        }
+    }
+ private:
+    NET  & _net;
+    bool   _delay;
+    PHASE  _phase;
+};
+
+// one phase of a firing over the targets, each worker on its own
+class FIREPART : public TPOOL::TASK
+{
+ public:
+    FIREPART (NET &net, bool excite) : _net(net),_excite(excite) {}
+    void Work (unsigned worker) {
+        if (_excite) {
+            _net.FireExcite (worker);
+        } else {
+            _net.FireMerge (worker);
+        }
+    }
+ private:
+    NET  & _net;
+    bool   _excite;
+};
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS NET  MEMBER FUNCTIONS
+//____________________________________________________________________
+
+void NET::Threads (unsigned n)
+{
+    delete _tpool;
+    _tpool = 0;
+    _bufs.clear();
+    if (n > 0) {
+        _tpool = new TPOOL(n);
+        _bufs.resize(_tpool->Size());
+        unsigned w;
+        foreach (w,0,_bufs.size()) {
+            _bufs[w]._out .resize(_bufs.size());
+            _bufs[w]._cuts.resize(_bufs.size());
+        }
+        _order.assign(TSIZE, 0);
+    }
+}
+
+// real firing of the given neurons on the thread pool, with the
+// result of Update() on each in turn; returns true if any of them
+// had energy to propagate
+bool NET::Fire (
+    const NID *ids,
+    unsigned   n,
+    FRONT     *qFiring,
+    bool       bDelay)
+{
+    // lay out the links of the neurons that have any, end to end
+    unsigned i, w, uLinks = 0;
+    _sources.clear();
+    _srcPos .clear();
+    _srcEnd .clear();
+    _posMark.assign(n, 0);
+    _posBase.resize(n);
+    foreach (i,0,n) {
+        NEURON neu = Neu(ids[i]);
+        _order  [ids[i]] = i+1;
+        _posBase[i]      = uLinks;
+        if (neu.State()     != NEURON::QUIET &&
+            neu.Potential() >  NEURON::THRESH_HIGH) {
+            _posMark[i] = POS_FIRES;
+        }
+        if (neu.Links().Slots() > 0) {
+            uLinks += neu.Links().Slots();
+            _sources.push_back(ids[i]);
+            _srcPos .push_back(i);
+            _srcEnd .push_back(uLinks);
+        }
+    }
+    _srcTotal .assign(_sources.size(), 0);
+    _srcMark  .assign(_sources.size(), 0);
+    _slotShare.resize(uLinks);
+    _slotHyper.resize(uLinks);
+    foreach (w,0,_bufs.size()) {
+        unsigned v;
+        foreach (v,0,_bufs.size()) {
+            _bufs[w]._out [v].clear();
+            _bufs[w]._cuts[v].clear();
+        }
+    }
+    // 1. total weight per source, and the links filed by target;
+    // 2. energy split as the neurons stand before the firing
+    FIRESTEAL total ((*this), bDelay, FIRESTEAL::TOTAL);
+    total.Run (uLinks);
+    FIRESTEAL split ((*this), bDelay, FIRESTEAL::SPLIT);
+    split.Run (uLinks);
+    // 3. links into each target in order; which neurons are
+    // excited before their turn
+    FIREPART merge ((*this), false);
+    _tpool->Run (&merge);
+    // 4. those neurons fire as they stand at their turn
+    FireResolve (ids, n, bDelay);
+    // 5. excite the targets; 6. age the links fired through
+    FIREPART excite ((*this), true);
+    _tpool->Run (&excite);
+    FIRESTEAL age ((*this), bDelay, FIRESTEAL::AGE);
+    age.Run (uLinks);
+
+    // flags, journal and wave front, in the order of the firing
+    bool bUpdated = false;
+    foreach (i,0,n) {
+        if (_posMark[i] & POS_FIRES) {
+            bUpdated = true;
+        }
+        _order[ids[i]] = 0;
+    }
+    foreach (i,0,_sources.size()) {
+        if (_srcMark[i] & SRC_IGNITES) {
+            Neu(_sources[i]).FlagSet(NEURON::FLAG_IGNITING);
+        }
+        if (_journal && (_srcMark[i] & SRC_AGED)) {
+            _aged.Push(_sources[i]);
+        }
+    }
+    foreach (i,0,_sources.size()) {
+        if (!(_srcMark[i] & SRC_IGNITES)) {
+            continue;
+        }
+        unsigned k, uBase = i ? _srcEnd[i-1] : 0;
+        LINK    *pData = Neu(_sources[i]).Links().Data() - uBase;
+        foreach (k,uBase,_srcEnd[i]) {
+            if (_slotShare[k] != NO_SHARE && (_slotHyper[k] & SLOT_QUEUES)) {
+                qFiring->Push (pData[k].Nid());
+            }
+        }
+    }
+    return bUpdated;
+}
+
+// sum the weights of the links to fire through, for the link range,
+// and file each such link with the worker owning its target; a
+// source may be shared with other ranges, so add up atomically
+void NET::FireTotal (
+    unsigned   worker,
+    unsigned   beg,
+    unsigned   end,
+    bool       bDelay)
+{
+    FIREBUF &b = _bufs[worker];
+    unsigned w, uWorkers = _bufs.size();
+    FIREBUF::CUT cut;
+    cut._beg    = beg;
+    cut._worker = worker;
+    foreach (w,0,uWorkers) {
+        b._cuts[w].push_back(cut);
+        b._cuts[w].back()._from = b._out[w].size();
+    }
+    unsigned s = upper_bound(_srcEnd.begin(), _srcEnd.end(), beg)
+                 - _srcEnd.begin();
+    for (; beg < end; s++) {
+        unsigned uBase  = s ? _srcEnd[s-1] : 0;
+        unsigned uStop  = min(end, _srcEnd[s]);
+        LINK    *pData  = Neu(_sources[s]).Links().Data() - uBase;
+        unsigned uTotal = 0;
+        for (; beg < uStop; beg++) {
+            LINK &link = pData[beg];
+            if (!link.Dead() && link.Syn().Delayed()==bDelay &&
+                _bbs.Exists(link.Nid())) {
+                uTotal += link.Syn().Weight();
+                b._out[sOwner(link.Nid(),uWorkers,TSIZE)].push_back(
+                    (uint64_t)link.Nid() << 32 | beg);
+            }
+        }
+        if (uTotal) {
+            __sync_fetch_and_add(&_srcTotal[s], uTotal);
+        }
+    }
+    foreach (w,0,uWorkers) {
+        b._cuts[w].back()._to = b._out[w].size();
+        if (b._cuts[w].back()._to == b._cuts[w].back()._from) {
+            b._cuts[w].pop_back();
+        }
+    }
+}
+
+// Spread() of real firing for the link range, run by a worker, for
+// the sources that fire as they stand before the firing: the share
+// of each slot goes to _slotShare, NO_SHARE if it is not fired
+// through. Nothing else is written.
+void NET::FireSplit (
+    SPREAD    &sp,
+    unsigned   beg,
+    unsigned   end,
+    bool       bDelay)
+{
+    unsigned s = upper_bound(_srcEnd.begin(), _srcEnd.end(), beg)
+                 - _srcEnd.begin();
+    for (; beg < end; s++) {
+        unsigned uStop = min(end, _srcEnd[s]);
+        if (_posMark[_srcPos[s]] & POS_FIRES) {
+            FireShares (sp, s, beg, uStop,
+                        Neu(_sources[s]).Potential(), bDelay);
+        } else {
+            fill (&_slotShare[beg], &_slotShare[0]+uStop,
+                  (unsigned)NO_SHARE);
+        }
+        beg = uStop;
+    }
+}
+
+// split the energy of source s among its slots in [beg,end)
+void NET::FireShares (
+    SPREAD    &sp,
+    unsigned   s,
+    unsigned   beg,
+    unsigned   end,
+    unsigned   uEnergy,
+    bool       bDelay)
+{
+    unsigned uBase = s ? _srcEnd[s-1] : 0;
+    LINK    *pData = Neu(_sources[s]).Links().Data() - uBase;
+    sp._links .clear();
+    sp._weight.clear();
+    for (; beg < end; beg++) {
+        LINK &link = pData[beg];
+        if (!link.Dead() && link.Syn().Delayed()==bDelay &&
+            _bbs.Exists(link.Nid())) {
+            sp._links .push_back(&link);
+            sp._weight.push_back(link.Syn().Weight());
+        } else {
+            _slotShare[beg] = NO_SHARE;
+        }
+    }
+    unsigned i, n = sp._links.size();
+    if (n == 0) {
+        return;
+    }
+    sp._share.resize(n);
+    ENERGY::Split (uEnergy, _srcTotal[s], &sp._weight[0], &sp._share[0], n);
+    foreach (i,0,n) {
+        _slotShare[sp._links[i] - pData] = sp._share[i];
+    }
+}
+
+// put the pieces of links into the targets of this worker in slot
+// order, which is the order of the sequential firing; a firing
+// neuron that a link from an earlier one reaches may stand otherwise
+// at its turn, so note those links
+void NET::FireMerge (unsigned worker)
+{
+    FIREBUF &b = _bufs[worker];
+    unsigned w, c, j;
+    b._in   .clear();
+    b._early.clear();
+    foreach (w,0,_bufs.size()) {
+        b._in.insert(b._in.end(), _bufs[w]._cuts[worker].begin(),
+                     _bufs[w]._cuts[worker].end());
+    }
+    sort (b._in.begin(), b._in.end());
+    foreach (c,0,b._in.size()) {
+        const uint64_t *pOut = &_bufs[b._in[c]._worker]._out[worker][0];
+        foreach (j,b._in[c]._from,b._in[c]._to) {
+            unsigned uPos = _order[pOut[j] >> 32];
+            if (uPos && (unsigned)pOut[j] < _posBase[uPos-1]) {
+                _posMark[uPos-1] |= POS_STALE;
+                b._early.push_back((uint64_t)(uPos-1) << 32 |
+                                   (unsigned)pOut[j]);
+            }
+        }
+    }
+    sort (b._early.begin(), b._early.end());
+}
+
+// neurons excited earlier in the firing, in turn: potential and
+// state as Excite() leaves them after the links from earlier
+// neurons, and the energy split again from there if it changed.
+// Only these few are done one by one; all the others split as
+// they stood before the firing.
+void NET::FireResolve (
+    const NID *ids,
+    unsigned   n,
+    bool       bDelay)
+{
+    vector<unsigned> vCur (_bufs.size(), 0);
+    unsigned i;
+    foreach (i,0,n) {
+        if (!(_posMark[i] & POS_STALE)) {
+            continue;
+        }
+        NEURON neu = Neu(ids[i]);
+        unsigned w = sOwner(ids[i], _bufs.size(), TSIZE);
+        vector<uint64_t> &vEarly = _bufs[w]._early;
+        NEU_POTENT pot = neu.Potential();
+        NEU_STATE  st  = neu.State();
+        for (; vCur[w] < vEarly.size() && (vEarly[vCur[w]] >> 32) == i;
+             vCur[w]++) {
+            unsigned k = (unsigned)vEarly[vCur[w]];
+            if (_slotShare[k] == NO_SHARE) {
+                continue;
+            }
+            pot = min(255, pot + (int)_slotShare[k]);
+            if (pot > NEURON::THRESH_BASE) {
+                st = NEURON::HYPER;
+            }
+        }
+        if (st  == NEURON::QUIET || pot <= NEURON::THRESH_HIGH) {
+            continue;
+        }
+        bool bFired = _posMark[i] & POS_FIRES;
+        _posMark[i] |= POS_FIRES;
+        unsigned s = lower_bound(_srcPos.begin(), _srcPos.end(), i)
+                     - _srcPos.begin();
+        if (s < _sources.size() && _srcPos[s] == i &&
+            (!bFired || pot != neu.Potential())) {
+            FireShares (_spread, s, _posBase[i], _srcEnd[s], pot, bDelay);
+        }
+    }
+}
+
+// Propagate() of real firing into the targets of this worker: each
+// takes the shares of its links in slot order, and is queued by the
+// link that leaves it HYPER first (SLOT_QUEUES)
+void NET::FireExcite (unsigned worker)
+{
+    FIREBUF &b = _bufs[worker];
+    unsigned c, j;
+    foreach (c,0,b._in.size()) {
+        const uint64_t *pOut = &_bufs[b._in[c]._worker]._out[worker][0];
+        foreach (j,b._in[c]._from,b._in[c]._to) {
+            unsigned k = (unsigned)pOut[j];
+            if (_slotShare[k] == NO_SHARE) {
+                continue;
+            }
+            NEURON neu = Neu((NID)(pOut[j] >> 32));
+            _slotHyper[k] = neu.Excite(_slotShare[k]) ? SLOT_HYPER : 0;
+            if (_slotHyper[k] && neu.Type() != OUTPUT &&
+                !neu.FlagTest(NEURON::FLAG_FIRING)) {
+                neu.FlagSet(NEURON::FLAG_FIRING);
+                _slotHyper[k] |= SLOT_QUEUES;
+            }
+        }
+    }
+}
+
+// record activity on the links fired through by aging, for the link
+// range; mark their sources
+void NET::FireAge (unsigned beg, unsigned end)
+{
+    unsigned s = upper_bound(_srcEnd.begin(), _srcEnd.end(), beg)
+                 - _srcEnd.begin();
+    for (; beg < end; s++) {
+        unsigned uBase = s ? _srcEnd[s-1] : 0;
+        unsigned uStop = min(end, _srcEnd[s]);
+        LINK    *pData = Neu(_sources[s]).Links().Data() - uBase;
+        unsigned char uMark = 0;
+        for (; beg < uStop; beg++) {
+            if (_slotShare[beg] == NO_SHARE) {
+                continue;
+            }
+            pData[beg].Syn().Aging();
+            uMark |= SRC_AGED;
+            if (_slotHyper[beg]) {
+                uMark |= SRC_IGNITES;
+            }
+        }
+        if (uMark) {
+            __sync_fetch_and_or(&_srcMark[s], uMark);
+        }
+    }
+}
+
+// wall clock in milliseconds
+static double sNow ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+// the graph: 1% of the sources hold MAX_SYNAP links, 9% hold 100,
+// and the rest one or two. All neurons are posted on the board, so
+// every link takes part; neuron state is restored after each round.
+void NET::BenchFire (unsigned uMaxThreads)
+{
+    const unsigned uSources = NSIZE/20;
+    const unsigned uRounds  = 20;
+    unsigned i, k, uLinks=0;
+    RNG rng = _rng.Split(1);
+    FRONT sources(TSIZE);
+    foreach (i,0,uSources) {
+        NID src = ISIZE + rng.Below(NSIZE-ISIZE);
+        unsigned r = rng.Below(100);
+        unsigned uFan = (r==0) ? NEURON::MAX_SYNAP : (r<10) ? 100 :
+                        1 + rng.Below(2);
+        foreach (k,0,uFan) {
+            NID dst = ISIZE + rng.Below(NSIZE-ISIZE);
+            if (dst != src && !Neu(src).Linked(dst)) {
+                Neu(src).Link(dst);
+                uLinks++;
+            }
+        }
+        sources.Push(src);
+        Neu(src).State(NEURON::HYPER);
+        Neu(src).PotentialAdd(200);
+    }
+    foreach (i,0,TSIZE) {
+        _bbs.Post(0, i, SYNAP());
+    }
+    vector<NEU_POTENT> potent(_pool.Potent(), _pool.Potent()+TSIZE);
+    vector<NEU_STATE>  state (_pool.State(),  _pool.State() +TSIZE);
+    vector<char>       flag  (_pool.Flag(),   _pool.Flag()  +TSIZE);
+    FRONT wave(TSIZE);
+
+    cout << "firing " << sources.size() << " neurons, " << uLinks
+         << " links; " << uRounds << " rounds" << endl;
+    cout << "threads\tms/round\tspeedup" << endl;
+    double dBase = 0;
+    unsigned t = 1;
+    while (t <= uMaxThreads) {
+        Threads(t);
+        double dTime = 0;
+        foreach (i,0,uRounds+1) {
+            double d0 = sNow();
+            Fire (sources.Data(), sources.size(), &wave);
+            // the first round warms up
+            if (i > 0) {
+                dTime += sNow() - d0;
+            }
+            copy (potent.begin(), potent.end(), _pool.Potent());
+            copy (state .begin(), state .end(), _pool.State());
+            copy (flag  .begin(), flag  .end(), _pool.Flag());
+            wave.Clear();
+        }
+        dTime /= uRounds;
+        if (t == 1) {
+            dBase = dTime;
+        }
+        cout << t << "\t" << dTime << "\t\t" << dBase/dTime << endl;
+        t = (t < uMaxThreads && 2*t > uMaxThreads) ? uMaxThreads : 2*t;
+    }
+    Threads(0);
+    _bbs.Clear();
+}
@@ -6,65 +6,218 @@
 //
 
 
+#include <string.h>
 #include "ring.h"
 #include <math.h>  // for ceil()
+#include <algorithm>
+#include <new>     // for placement new
 
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// STATIC DECLARATION
+// UTILITY FUNCTIONS
 //____________________________________________________________________
-static NET * pGlobalNet;
-
+// scramble a signature key into 64 bits (splitmix64 finalizer)
+static uint64_t sMixKey (unsigned key)
+{
+    uint64_t z = key + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// UTILITY FUNCTIONS
+// CLASS FUNCTIONS - ARENA
 //____________________________________________________________________
-static bool RingCompare (NID n1, NID n2)
+ARENA::~ARENA ()
+{
+    vector<pair<char *,size_t> >::iterator it;
+    foreachv (it,_blocks) {
+        delete [] (*it).first;
+    }
+}
+
+// carve from the current block; move on to the next retained block,
+// or get a new one when it is used up.
+void * ARENA::Alloc (size_t size)
+{
+    // keep everything pointer aligned
+    size = (size + sizeof(void *)-1) & ~(sizeof(void *)-1);
+    while (_block < _blocks.size()) {
+        if (_used + size <= _blocks[_block].second) {
+            void *p = _blocks[_block].first + _used;
+            _used += size;
+            return p;
+        }
+        _block++;
+        _used = 0;
+    }
+    size_t bsize = iBlockSize;
+    if (size > bsize) {
+        bsize = size;
+    }
+    _blocks.push_back(make_pair(new char [bsize], bsize));
+    _block = _blocks.size()-1;
+    _used  = size;
+    return _blocks[_block].first;
+}
+
+void * ARENA::Grow (void *p, size_t used, size_t size)
 {
-    return pGlobalNet->Compare(n1, n2);
+    void *q = Alloc(size);
+    if (used) {
+        memcpy (q, p, used);
+    }
+    return q;
 }
 
+
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // CLASS FUNCTIONS - BBS, SIGN, STAMP
 //____________________________________________________________________
-void NET::Sort (list<NID> * pList)
+void NET::Sort (FRONT * pList)
 {
-    pGlobalNet = this;
-    pList->sort(RingCompare);
+    _rank.Sort(pList, _pool.Potent());
 }
 
 
-// append NID to signature
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CLASS FUNCTIONS - RANK
+//____________________________________________________________________
+
+// bucket of a potential; highest potential goes first
+static inline unsigned sRankBucket (NEU_POTENT p)
+{
+    if (p < 0)   p = 0;
+    if (p > 255) p = 255;
+    return 255 - p;
+}
+
+void RANK::Sort (FRONT *pList, const NEU_POTENT *potent)
+{
+    unsigned i, n = pList->size();
+    if (n < 2) {
+        return;
+    }
+    memset (_count, 0, sizeof(_count));
+    foreach (i, 0, n) {
+        _count[sRankBucket(potent[(*pList)[i]])]++;
+    }
+    // bucket start positions
+    unsigned sum = 0;
+    foreach (i, 0, iBuckets) {
+        unsigned c = _count[i];
+        _count[i] = sum;
+        sum += c;
+    }
+    _sorted.resize(n);
+    foreach (i, 0, n) {
+        NID id = (*pList)[i];
+        _sorted[_count[sRankBucket(potent[id])]++] = id;
+    }
+    foreach (i, 0, n) {
+        pList->Keep(i, _sorted[i]);
+    }
+}
+
+
+// append NID to signature, keeping keys sorted;
+// signatures are short, so a linear insert is cheap.
 void SIGN::Append(const NID id, const SYNAP syn)
 {
-    // use full ASCII code to encode the signature
-    const char ASCII[] = 
-        {'0','1','2','3','4','5','6','7','8','9','-','=',
-         '~','!','@','#','$','%','^','&','(',')','_','+',
-         ';',':','<','>','?',',','.','/','[',']','{','}',
-         'a','b','c','d','e','f','g','h','i','j','k','l','m',
-         'n','o','p','q','r','s','t','u','v','w','x','y','z',
-         'A','B','C','D','E','F','G','H','I','J','K','L','M',
-         'N','O','P','Q','R','S','T','U','V','W','X','Y','Z'
-        };
-    const unsigned asize = sizeof(ASCII)/sizeof(char);
-    // derive each digit by iterative division
-    unsigned i=0;
-    char buf[10];
-    NID dig, quo, rem;
-    dig = id;
-    while (dig>0) {
-        quo = dig/asize;
-        rem = dig%asize;
-        buf[i++] = ASCII[rem];
-        dig = quo;
+    unsigned key = (id << 1) | (syn.Delayed() ? 1 : 0);
+    if (_size == _cap) {
+        Reserve(_cap ? 2*_cap : 4);
     }
-    // use '*' to indicate delayed firing
-    if (syn.Delayed()) {
-        buf[i++] = '*';
+    unsigned *p = upper_bound(_key, _key+_size, key);
+    memmove (p+1, p, sizeof(unsigned) * (_key+_size-p));
+    *p = key;
+    _size++;
+    _hash += sMixKey(key);
+}
+
+// make room for n keys, in the arena or on the heap
+void SIGN::Reserve(unsigned n)
+{
+    if (n <= _cap) {
+        return;
+    }
+    if (_arena) {
+        _key = (unsigned *)_arena->Grow(_key, sizeof(unsigned)*_size,
+                                         sizeof(unsigned)*n);
+    } else {
+        unsigned *key = new unsigned [n];
+        if (_size) {
+            memcpy (key, _key, sizeof(unsigned)*_size);
+        }
+        delete [] _key;
+        _key = key;
     }
-    buf[i] = '\0';
-    _sig.append(buf);
+    _cap = n;
+}
+
+// deep copy; storage stays where this signature keeps it
+void SIGN::operator =(const SIGN &a)
+{
+    if (this == &a) {
+        return;
+    }
+    _size = 0;
+    Reserve(a._size);
+    if (a._size) {
+        memcpy (_key, a._key, sizeof(unsigned)*a._size);
+    }
+    _size = a._size;
+    _hash = a._hash;
+}
+
+// take keys already in ascending order
+void SIGN::Assign(const unsigned *key, unsigned n)
+{
+    _size = 0;
+    _hash = 0;
+    Reserve(n);
+    unsigned i;
+    foreach (i, 0, n) {
+        _key[i] = key[i];
+        _hash  += sMixKey(key[i]);
+    }
+    _size = n;
+}
+
+bool SIGN::operator ==(const SIGN &a) const
+{
+    return (_hash == a._hash && _size == a._size &&
+            (_size==0 || memcmp(_key, a._key,
+                                sizeof(unsigned) * _size)==0));
+}
+
+void SIGN::Write(ostream &out) const
+{
+    unsigned i;
+    foreach (i, 0, _size) {
+        if (i) {
+            out << ",";
+        }
+        out << (_key[i] >> 1);
+        // use '*' to indicate delayed firing
+        if (_key[i] & 1) {
+            out << "*";
+        }
+    }
+}
+
+// copy of a stamp, in the given arena
+STAMP::STAMP(ARENA *a, STAMP *s) : SIGN(a),_strength(s->_strength),
+    _syns(0),_nids(0),_size(0),_cap(0)
+{
+    SIGN::operator=(*s);
+    if (s->_size) {
+        _nids = (NID   *)a->Alloc(sizeof(NID)  *s->_size);
+        _syns = (SYNAP *)a->Alloc(sizeof(SYNAP)*s->_size);
+        memcpy (_nids, s->_nids, sizeof(NID)*s->_size);
+        memcpy ((void *)_syns, s->_syns, sizeof(SYNAP)*s->_size);
+    }
+    _size = _cap = s->_size;
 }
 
 void STAMP::Append(
@@ -73,18 +226,27 @@ void STAMP::Append(
 {
     // append to signature (parent function)
     SIGN::Append(id, syn);
-    // append to NID vector
-    _nids.push_back(id );
-    _syns.push_back(syn);
+    // append to NID array
+    if (_size == _cap) {
+        unsigned cap = _cap ? 2*_cap : 4;
+        _nids = (NID   *)Arena()->Grow(_nids, sizeof(NID)  *_size,
+                                              sizeof(NID)  *cap);
+        _syns = (SYNAP *)Arena()->Grow(_syns, sizeof(SYNAP)*_size,
+                                              sizeof(SYNAP)*cap);
+        _cap  = cap;
+    }
+    _nids[_size] = id;
+    _syns[_size] = syn;
+    _size++;
     _strength += syn.Weight();
 }
 
 // return true if the signature contains delayed edge
 bool STAMP::Delayed ()
 {
-    vector<SYNAP>::iterator it;
-    foreachv (it, _syns) {
-        if ((*it).Delayed()) {
+    unsigned i;
+    foreach (i, 0, _size) {
+        if (_syns[i].Delayed()) {
             return true;
         }
     }
@@ -96,30 +258,27 @@ bool STAMP::RemoveDelay ()
 {
     SIGN::Clear();
     _strength = 0;
-    vector<SYNAP>::iterator sit;
-    vector<NID  >::iterator nit;
-    sit = _syns.begin();
-    nit = _nids.begin();
-    while (sit != _syns.end()) {
-        if ((*sit).Delayed()) {
-            _syns.erase(sit);
-            _nids.erase(nit);
-        } else {
-            SIGN::Append(*nit, *sit);
-            _strength += (*sit).Weight();
-            nit++;
-            sit++;
+    unsigned i, n=0;
+    foreach (i, 0, _size) {
+        if (!_syns[i].Delayed()) {
+            SIGN::Append(_nids[i], _syns[i]);
+            _strength += _syns[i].Weight();
+            _nids[n] = _nids[i];
+            _syns[n] = _syns[i];
+            n++;
         }
     }
+    _size = n;
+    return true;
 }
 
 // sum of ages for all synapses in signature
 unsigned STAMP::Age ()
 {
     unsigned sum_age=0;
-    vector<SYNAP>::iterator sit;
-    for (sit=_syns.begin(); sit!=_syns.end(); sit++) {
-        sum_age += (*sit).Age();
+    unsigned i;
+    foreach (i, 0, _size) {
+        sum_age += _syns[i].Age();
     }
     return sum_age;
 }
@@ -127,32 +286,28 @@ unsigned STAMP::Age ()
 void STAMP::Clear()
 { 
     SIGN :: Clear();
-    _nids . clear();
-    _syns . clear();
+    _size = 0;
 }
 
 
 BBS::~BBS() 
 {
-    Release();
-}
-
-
-// release STAMP memory
-void BBS::Release()
-{
-    for (_it=_board.begin();
-         _it!=_board.end(); _it++) {
-        delete (*_it).second;
-    }
 }
 
 
+// STAMPs are dropped with the arena, all at once
 void BBS::Clear() 
 {
-    Release();
+    foreachv (_it, _board) {
+        NID n = (*_it).first;
+        _member[n>>5] &= ~(1u << (n&31));
+    }
     _stamps . clear ();
     _board  . clear ();
+    _comb   . clear ();
+    _winners. clear ();
+    _losers . clear ();
+    _arena  . Reset ();
 }
 
 // retrieve stamp associated with destination NID
@@ -162,7 +317,7 @@ bool BBS::GetStamp (
     STAMP * &ps)
 {
     bool fResult = false;
-    hash_map<NID, STAMP *>::iterator its;
+    FLATMAP<NID, STAMP *>::iterator its;
     its = _board.find(dst);
     if (its != _board.end()) {
         ps = (*its).second;
@@ -180,12 +335,15 @@ bool BBS::Post(
     SYNAP synap)
 {
     STAMP * pSt;
-    hash_map<NID, STAMP *>::iterator its;
+    FLATMAP<NID, STAMP *>::iterator its;
     its = _board.find(dst);
     if (its == _board.end()) {
-        pSt = new STAMP;
-        //_board.insert(pair<NID, STAMP*>(dst, pSt));
+        pSt = new (_arena.Alloc(sizeof(STAMP))) STAMP(&_arena);
         _board[dst] = pSt;
+        if (dst >= _member.size()*32) {
+            _member.resize(dst/32+1, 0);
+        }
+        _member[dst>>5] |= (1u << (dst&31));
     } else {
         pSt = (*its).second;
     }
@@ -198,20 +356,27 @@ bool BBS::Post(
 STAMP * BBS::PostComb (NID dst, STAMP *pst)
 {
     // make a copy of the stamp, and remove delayed edge
-    STAMP *pstnew = new STAMP(pst);
+    STAMP *pstnew = new (_arena.Alloc(sizeof(STAMP))) STAMP(&_arena, pst);
     pstnew->RemoveDelay();
-    // post onto board
-    hash_map<NID, STAMP *>::iterator its;
-    its = _board.find(dst);
-    if (_board.find(dst) == _board.end()) {
-        _board[dst] = pstnew;
-    } else {
-        delete (*its).second;
-        (*its).second = pstnew;
-    }
+    // post onto the side board; an old copy stays in the arena
+    _comb[dst] = pstnew;
     return pstnew;
 }
 
+// retrieve combinational pattern associated with destination NID
+bool BBS::GetComb (
+    NID     dst,
+    STAMP * &ps)
+{
+    FLATMAP<NID, STAMP *>::iterator its;
+    its = _comb.find(dst);
+    if (its == _comb.end()) {
+        return false;
+    }
+    ps = (*its).second;
+    return true;
+}
+
 // use hash table to pick best neuron candidate
 // among the ones with same firing patterns;
 // 0. remove neurons whose firing pattern does not match;
@@ -226,16 +391,15 @@ STAMP * BBS::PostComb (NID dst, STAMP *pst)
 
 bool BBS::Select(bool bVerbose) 
 {
-    // store combinational patterns derived from delayed ones;
-    // may need to use HASH instead of hash_map to improve runtime.
-    BBS bbsComb(_net);
-    hash_str::iterator its;
+    // combinational patterns derived from delayed ones are kept
+    // in _comb, next to the board, until Clear.
+    hash_sig::iterator its;
     
     if (bVerbose) { cout << " :STAMP: "; }
     foreachv (_it, _board) {
         NID    nid1 = (*_it).first;
         STAMP *nst1 = (*_it).second;
-        if (bVerbose) { cout << nst1->Cstr() << " "; }
+        if (bVerbose) { nst1->Write(cout); cout << " "; }
         if (!_net.Get(nid1).Match(nst1)) {
             // firing pattern does not match internal
             if (bVerbose) { cout << "(MISS) "; }
@@ -246,19 +410,19 @@ bool BBS::Select(bool bVerbose)
         // for new fired neuron with no existing signs,
         // remove delayed link for combinational pattern testing
         if (_net.Get(nid1).Sign().Empty() && nst1->Delayed()) {
-            nst1 = bbsComb.PostComb (nid1, nst1);
+            nst1 = PostComb (nid1, nst1);
             d1 = true;
         }
-        its = _stamps.find(nst1->Cstr());
+        its = _stamps.find(nst1);
         if (its == _stamps.end()) {
             // first unique pattern; insert in hash
-            _stamps[nst1->Cstr()] = nid1;
+            _stamps[nst1] = nid1;
         } else {
             // existing pattern; compare synapse strength
             NID nid2; STAMP *nst2;
             nid2 = (*its).second;
             // retrieve combinational pattern first
-            if (bbsComb.GetStamp (nid2, nst2)) {
+            if (GetComb (nid2, nst2)) {
                 d2 = true;
             } else {
                 nst2 = _board[nid2];
@@ -268,7 +432,7 @@ bool BBS::Select(bool bVerbose)
             bool win2 = (_net.Get(nid1).Type()==OUTPUT) && d2;
             if (win1  || (!win2 && Compare(nid1,nid2,nst1,nst2))) {
                 _stamps.erase(its);
-                _stamps[nst1->Cstr()] = nid1;
+                _stamps[nst1] = nid1;
                 if (bVerbose) {
                     cout << "("<< nid1 <<") ";
                 }
@@ -279,7 +443,7 @@ bool BBS::Select(bool bVerbose)
     
     // process delayed edges after uniquefication of combinational
     // patterns
-    if (bbsComb.Size() > 0) {
+    if (_comb.size() > 0) {
         unsigned idx=0;
         foreachv (_it, _board) {
             NID    nid1 = (*_it).first;
@@ -289,26 +453,44 @@ bool BBS::Select(bool bVerbose)
                 // restore delayed edge in BBS; 
                 // (it must have been processed and stored earlier)
                 STAMP *nst2;
-                bool bRes = bbsComb.GetStamp (nid1,nst2);
+                bool bRes = GetComb (nid1,nst2);
                 assert (bRes);
-                its = _stamps.find(nst2->Cstr());
+                its = _stamps.find(nst2);
                 if (its != _stamps.end() && (*its).second==nid1) {
                     // remove combinational pattern;
                     _stamps.erase(its);
                     // insert delayed pattern,
                     // only if one does not already exist
-                    if (_stamps.find(nst1->Cstr())==_stamps.end()) {
-                        _stamps[nst1->Cstr()] = nid1;
+                    if (_stamps.find(nst1)==_stamps.end()) {
+                        _stamps[nst1] = nid1;
                     }
                 }
                 idx++;
             }
         }
-        assert(idx==bbsComb.Size());
+        assert(idx==_comb.size());
     }
+    Partition();
     return true;
 }
 
+// one pass over the board: a neuron wins if the signature table
+// still maps its pattern to itself; it loses if its pattern
+// was beaten, or did not match at all.
+void BBS::Partition()
+{
+    _winners.clear();
+    _losers .clear();
+    foreachv (_it, _board) {
+        hash_sig::iterator sit = _stamps.find((*_it).second);
+        if (sit != _stamps.end() && (*sit).second==(*_it).first) {
+            _winners.push_back(make_pair((*_it).first,(*_it).second));
+        } else {
+            _losers .push_back(make_pair((*_it).first,(*_it).second));
+        }
+    }
+}
+
 // first compare synaps strength; then synapse age
 // for tie, compare neuron potential
 bool BBS::Compare(
@@ -334,61 +516,17 @@ bool BBS::Compare(
     return bResult;
 }
 
-void BBS::IterBegin(bool f) 
-{
-    _fIterFiring = f;
-    _it = _board.begin();
-}
-
-bool BBS::IterNext(NID &n)
-{
-    bool fResult=false;
-    if (_it!=_board.end()) {
-        hash_str::iterator sit;
-        // find the NID associated with this pattern
-        // _fIterFiring=1 : winners;
-        // _fIterFiring=0 : losers;
-        sit = _stamps.find(((*_it).second)->Cstr());
-        if (sit == _stamps.end()) {
-            // not qualified for firing due to patter mismatch
-            if (_fIterFiring) {
-                _it++; fResult = IterNext (n);
-            } else {
-                n = (*_it).first;
-                _it++; fResult = true;
-            }
-        } else if (_fIterFiring ^ ((*_it).first==(*sit).second)) {
-            // iter-flag differs with matching status
-            _it++; fResult = IterNext (n);
-        } else {
-            // found matching
-            n = (*_it).first;
-            _it++; fResult = true;
-        }
-    }
-    return fResult;
-}
-
-// erase losers from the board; 
-// TODO: improve runtime performance later
+// erase losers from the board
 
 void BBS::Filter()
 {
-    vector<NID> listid;
-    _it = _board.begin();
-    while (_it!=_board.end()) {
-        hash_str::iterator sit;
-        sit = _stamps.find(((*_it).second)->Cstr());
-        if (sit == _stamps.end() || 
-            ((*_it).first != (*sit).second)) {
-            listid.push_back ((*_it).first);
-        }
-        _it ++;
-    }
-    vector<NID>::iterator it;
-    foreachv (it, listid) {
-        _board.erase (*it);
+    RESULT::iterator it;
+    foreachv (it, _losers) {
+        NID n = (*it).first;
+        _board.erase (n);
+        _member[n>>5] &= ~(1u << (n&31));
     }
+    _losers.clear();
 }
 
 
@@ -6,14 +6,14 @@
 //
 
 #include "ring.h"
+#include <time.h>
+#include <unistd.h>
 
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // STATIC FUNCTIONS DEFINED IN THIS FILE
 //____________________________________________________________________
 static void     sPrintDebug ();
-static unsigned sGetInteger (unsigned char *memblock);
-static void     sReadPad    (unsigned char *m, IPAD &dn);
 
 // size of input image pad width, 
 // the square of which is the size of input neurons
@@ -21,10 +21,32 @@ static void     sReadPad    (unsigned char *m, IPAD &dn);
 
 int main (int argc, char **argv)
 {
-    const char *chUsage="ring [-g][-n][-v] training_input.dat\n"
+    const char *chUsage=
+        "ring [-g][-n][-v][-b][-t N][-r S][-l F][-y F][-j F][-s F]\n"
+        "     [-L F][-o N][-c N][-k N][-e N][-x N][-p][-d N][-i][-I]\n"
+        "     training_input.dat\n"
         "\t-g generating a sample training data file\n"
+        "\t-b benchmark the energy kernels and parallel firing\n"
+        "\t   (scaling up to -t N threads, default all cores)\n"
         "\t-n reading data file from MNIST benchmark suite\n"
-        "\t-v turn on verbose mode\n";
+        "\t-v turn on verbose mode\n"
+        "\t-t use N threads for firing (default: sequential)\n"
+        "\t-r seed of the random firing (default: 1234567)\n"
+        "\t-l resume from snapshot file F before training\n"
+        "\t-y replay link changes journaled in F (after -l)\n"
+        "\t-j journal the link changes made while training to F\n"
+        "\t-s save a snapshot to file F after training\n"
+        "\t-L MNIST labels file F, matching the images\n"
+        "\t-o first MNIST sample to train on (default: 0)\n"
+        "\t-c number of MNIST samples, 0 for all (default: 5)\n"
+        "\t-k take every N-th MNIST sample (default: 1)\n"
+        "\t-e number of passes over the MNIST samples (default: 1)\n"
+        "\t-x pixels at or above N are on (default: 128)\n"
+        "\t-p make the MNIST training frames on a second thread\n"
+        "\t-d write every N-th training frame to gif/, 1 for all\n"
+        "\t   (default: 0, none)\n"
+        "\t-i recognize the MNIST samples after training\n"
+        "\t-I the same, 64 samples per pass\n";
     if (argc <=1) {
         cerr << chUsage;
         return 0;
@@ -37,24 +59,79 @@ int main (int argc, char **argv)
         // optionally generate training data
         if (strcmp(argv[iArg], "-g")==0) {
             iwork.GenTrainingSet();
+        } else if (strcmp(argv[iArg], "-b")==0) {
+            iwork.bench(true);
         } else if (strcmp(argv[iArg], "-n")==0) {
             iwork.mnist(true);
         } else if (strcmp(argv[iArg], "-v")==0) {
             iwork.verbose(true);
+        } else if (strcmp(argv[iArg], "-t")==0 && iArg+1 < argc) {
+            iwork.threads(atoi(argv[++iArg]));
+        } else if (strcmp(argv[iArg], "-r")==0 && iArg+1 < argc) {
+            iwork.seed(strtoull(argv[++iArg], 0, 10));
+        } else if (strcmp(argv[iArg], "-l")==0 && iArg+1 < argc) {
+            iwork.load(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "-s")==0 && iArg+1 < argc) {
+            iwork.save(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "-j")==0 && iArg+1 < argc) {
+            iwork.journal(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "-y")==0 && iArg+1 < argc) {
+            iwork.replay(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "-p")==0) {
+            iwork.pipe(true);
+        } else if (strcmp(argv[iArg], "-d")==0 && iArg+1 < argc) {
+            iwork.gifs(atoi(argv[++iArg]));
+        } else if (strcmp(argv[iArg], "-i")==0) {
+            iwork.infer(true);
+        } else if (strcmp(argv[iArg], "-I")==0) {
+            iwork.infer(true);
+            iwork.batch(true);
+        } else if (strcmp(argv[iArg], "-L")==0 && iArg+1 < argc) {
+            iwork.labels(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "-o")==0 && iArg+1 < argc) {
+            iwork.first(atoi(argv[++iArg]));
+        } else if (strcmp(argv[iArg], "-c")==0 && iArg+1 < argc) {
+            iwork.count(atoi(argv[++iArg]));
+        } else if (strcmp(argv[iArg], "-k")==0 && iArg+1 < argc) {
+            iwork.stride(atoi(argv[++iArg]));
+        } else if (strcmp(argv[iArg], "-e")==0 && iArg+1 < argc) {
+            iwork.epochs(atoi(argv[++iArg]));
+        } else if (strcmp(argv[iArg], "-x")==0 && iArg+1 < argc) {
+            iwork.threshold(atoi(argv[++iArg]));
         } else {
             chFileName = argv[iArg];
         }
     }
+    if (iwork.bench()) {
+        iwork.BenchEnergy();
+        iwork.BenchFiring();
+        return 0;
+    }
     // to help debugging
     if (iwork.verbose()) {
         //sPrintDebug();
     }
     if (iwork.mnist()) {
-        NET inet(IPAD_SIZE*IPAD_SIZE);
+        NET inet(IPAD_SIZE*IPAD_SIZE, iwork.seed());
+        inet.Threads(iwork.threads());
+        inet.Threshold(iwork.threshold());
+        if (!iwork.Resume(inet)) {
+            return 1;
+        }
         iwork.TrainMnist(inet,chFileName);
+        if (iwork.save() && !inet.Save(iwork.save())) {
+            return 1;
+        }
     } else {
-        NET inet(9);
+        NET inet(9, iwork.seed());
+        inet.Threads(iwork.threads());
+        if (!iwork.Resume(inet)) {
+            return 1;
+        }
         iwork.TrainPad  (inet,chFileName);
+        if (iwork.save() && !inet.Save(iwork.save())) {
+            return 1;
+        }
     }
 }
 
@@ -81,6 +158,96 @@ void WORK::GenTrainingSet()
 }
 
 
+// restore the net from a snapshot and journal, if any;
+// then start journaling on top of that state
+bool WORK::Resume(NET &net)
+{
+    if (_load && !net.Load(_load)) {
+        return false;
+    }
+    if (_replay && !net.Replay(_replay)) {
+        return false;
+    }
+    if (_journal && !net.Journal(_journal)) {
+        return false;
+    }
+    return true;
+}
+
+
+// time the energy distribution kernels on random link weights,
+// for fan-outs up to the maximum synapse count;
+// check each of them against the scalar reference.
+void WORK::BenchEnergy()
+{
+    typedef void (*SPLIT)(unsigned,unsigned,
+                          const ENERGY::WEIGHT *,unsigned *,unsigned);
+    static const char *chNames[] = {"float","scalar","sse2","avx2","split"};
+    static const SPLIT pSplits[] = {
+        ENERGY::SplitFloat, ENERGY::SplitScalar, ENERGY::SplitSSE2,
+        ENERGY::SplitAVX2,  ENERGY::Split };
+    static const unsigned uFanouts[] = {8, 64, 256, NEURON::MAX_SYNAP};
+    const unsigned uKernels = sizeof(pSplits)/sizeof(pSplits[0]);
+    const unsigned uRounds  = 20000;
+    RNG rng(_seed);
+
+    cout << "split kernel: " << ENERGY::Kernel() << endl;
+    cout << "fanout";
+    unsigned k, f, r, i;
+    foreach (k,0,uKernels) { cout << "\t" << chNames[k]; }
+    cout << "\t(ns/link; float mismatches)" << endl;
+
+    foreach (f,0,sizeof(uFanouts)/sizeof(uFanouts[0])) {
+        unsigned n = uFanouts[f];
+        vector<ENERGY::WEIGHT> w(n);
+        vector<unsigned> ref(n), share(n);
+        unsigned uTotal = 0;
+        foreach (i,0,n) {
+            w[i] = 1 + rng.Below(15);
+            uTotal += w[i];
+        }
+        cout << n;
+        unsigned uMismatch = 0;
+        foreach (k,0,uKernels) {
+            clock_t t0 = clock();
+            unsigned uSum = 0;
+            foreach (r,0,uRounds) {
+                pSplits[k] (r & 255, uTotal, &w[0], &share[0], n);
+                uSum += share[r % n];
+            }
+            double ns = 1e9 * (clock()-t0) / CLOCKS_PER_SEC / uRounds / n;
+            // verify on the full energy range
+            bool bSame = true;
+            foreach (r,0,256) {
+                ENERGY::SplitScalar (r, uTotal, &w[0], &ref[0], n);
+                pSplits[k] (r, uTotal, &w[0], &share[0], n);
+                foreach (i,0,n) {
+                    if (share[i] != ref[i]) {
+                        bSame = false;
+                        uMismatch += (k==0);
+                    }
+                }
+            }
+            cout << "\t" << ns << ((bSame || k==0) ? "" : "(!)");
+            // keep the optimizer from dropping the loop
+            if (uSum == 0xFFFFFFFF) { cout << " "; }
+        }
+        cout << "\t" << uMismatch << endl;
+    }
+}
+
+// scaling of parallel firing over thread counts
+void WORK::BenchFiring()
+{
+    unsigned n = _threads;
+    if (n == 0) {
+        long c = sysconf(_SC_NPROCESSORS_ONLN);
+        n = (c > 0) ? (unsigned)c : 1;
+    }
+    NET inet(IPAD_SIZE*IPAD_SIZE, _seed);
+    inet.BenchFire(n);
+}
+
 void WORK::TrainPad(
     NET & net, 
     const char *chFileName)
@@ -108,58 +275,160 @@ void WORK::TrainMnist(
     NET & net, 
     const char *chFileName) 
 {
-    ifstream datafile (chFileName, ios::in|ios::binary|ios::ate);
-    if (!datafile.is_open()) {
-        cerr << "ERROR: file "<<chFileName<<" cannot be opened!" << endl;
+    IDX images;
+    if (!images.Open(chFileName)) {
         return;
     }
-    // read the entire file together
-    unsigned char * memblock;
-    ifstream::pos_type size;
-    size = datafile.tellg();
-    memblock = new unsigned char [size];
-    datafile.seekg (0, ios::beg);
-    datafile.read ((char *)memblock, size);
-    datafile.close();
+    if (images.Type() != IDX::UBYTE || images.Dims() != 3) {
+        cerr << "ERROR: file "<<chFileName<<" holds no byte images!" << endl;
+        return;
+    }
+    IDX labels;
+    bool bLabels = false;
+    if (_labels && labels.Open(_labels)) {
+        bLabels = labels.Count() == images.Count();
+        if (!bLabels) {
+            cerr << "ERROR: labels do not match the images!" << endl;
+        }
+    }
     if (_verb) {
-        cout << "the complete MNIST file content is in memory" <<endl;
+        cout << "the MNIST file is mapped into memory" <<endl;
     }
     // process the image blocks
-    ProcessMnist (net,memblock);
-    delete[] memblock;
+    ProcessMnist (net, images, bLabels ? &labels : 0);
+    if (_infer) {
+        InferMnist (net, images, bLabels ? &labels : 0);
+    }
+}
+
+// list the outputs each sample activates on the frozen net
+void WORK::InferMnist (
+    NET & net,
+    IDX & images,
+    IDX * labels)
+{
+    unsigned iRows = images.Dim(1);
+    unsigned iCols = images.Dim(2);
+    unsigned i, uImages=0;
+    clock_t tInfer = 0;
+    net.Freeze();
+    IDXFEED feed (images, _first, _count, _stride);
+    // samples go one by one, or 64 per pass in batch mode
+    unsigned uBatch = _batch ? 64 : 1;
+    vector<unsigned> vSample;
+    vector<IPAD *>   vPads;
+    vector< vector<NID> > vOutputs;
+    bool bMore = true;
+    while (bMore) {
+        bMore = feed.Next(i);
+        if (bMore) {
+            IPAD datapad(iCols, iRows, images.Sample(i));
+            IPAD *neupad = new IPAD(IPAD_SIZE,IPAD_SIZE);
+            neupad->Scale(datapad);
+            vSample.push_back(i);
+            vPads  .push_back(neupad);
+        }
+        if (vPads.empty() || (bMore && vPads.size() < uBatch)) {
+            continue;
+        }
+        clock_t t0 = clock();
+        if (_batch) {
+            net.Infer (vPads, vOutputs);
+        } else {
+            vOutputs.assign (1, net.Infer(*vPads[0]));
+        }
+        tInfer += clock() - t0;
+        unsigned k;
+        foreach (k,0,vPads.size()) {
+            WriteOutputs (vSample[k], labels, vOutputs[k]);
+            delete vPads[k];
+        }
+        uImages += vPads.size();
+        vSample.clear();
+        vPads  .clear();
+    }
+    cout << "infer: " << uImages << " images, "
+         << 1e3 * tInfer / CLOCKS_PER_SEC << " ms" << endl;
+}
+
+void WORK::WriteOutputs (
+    unsigned i,
+    IDX    * labels,
+    const vector<NID> &vOut)
+{
+    cout << "sample " << i;
+    if (labels) {
+        cout << " label " << labels->Value(i);
+    }
+    cout << " :";
+    vector<NID>::const_iterator it;
+    foreachv (it, vOut) {
+        cout << " " << *it;
+    }
+    cout << endl;
 }
 
 void WORK::ProcessMnist (
     NET & net, 
-    unsigned char *memblock)
+    IDX & images,
+    IDX * labels)
 {
-    unsigned iMagic, iMagCount, iRows, iCols, iPos;
-    iMagic    = sGetInteger (memblock);
-    iMagCount = sGetInteger (memblock+4);
-    iRows     = sGetInteger (memblock+8);
-    iCols     = sGetInteger (memblock+12);
+    unsigned iRows = images.Dim(1);
+    unsigned iCols = images.Dim(2);
     if (_verb) {
-        cout << "Magic :" << iMagic << endl;
-        cout << "count :" << iMagCount << endl;
+        cout << "count :" << images.Count() << endl;
         cout << "rows  :" << iRows << endl;
         cout << "cols  :" << iCols << endl;
     }
-    iPos = 16;
-    // pick a small set for initial experiments 
-    iMagCount = 5;
-    for (unsigned i=0; i<iMagCount; ++i) {
-        IPAD datapad(28,28);
-        sReadPad (memblock+iPos, datapad);
-        IPAD neupad (IPAD_SIZE,IPAD_SIZE);
-        neupad.Scale(datapad);
-        // 1. animation from single pad for training
-        IMOV movie(neupad);
-        movie.Roll();
-        net.Train (movie);
-        // 2.simply update neural-net with image pad
-        // net.Input (neupad);
-        // net.Update();
-        iPos += datapad.size();
+    unsigned e, i, uUpdates=0;
+    clock_t tTrain = 0;
+    GIFSINK::Every(_gifs);
+    if (_pipe) {
+        // frames are made on the feed thread, in the same order
+        FRAMEFEED frames (images, IPAD_SIZE, _first, _count, _stride,
+                          _epochs);
+        FRAMEFEED::FRAME frame;
+        while (frames.Next(frame)) {
+            if (frame._first && labels && _verb) {
+                cout << "sample " << frame._sample << " label "
+                     << labels->Value(frame._sample) << endl;
+            }
+            clock_t t0 = clock();
+            net.Train (*frame._pad);
+            tTrain   += clock() - t0;
+            uUpdates ++;
+            frames.Done(frame._pad);
+        }
+        frames.Report(cout);
+    } else {
+        foreach (e,0,_epochs) {
+            IDXFEED feed (images, _first, _count, _stride);
+            while (feed.Next(i)) {
+                // the pixels are used in place
+                IPAD datapad(iCols, iRows, images.Sample(i));
+                IPAD neupad (IPAD_SIZE,IPAD_SIZE);
+                neupad.Scale(datapad);
+                if (labels && _verb) {
+                    cout << "sample " << i << " label "
+                         << labels->Value(i) << endl;
+                }
+                // 1. animation from single pad for training
+                IMOV movie(neupad);
+                movie.Roll();
+                clock_t t0 = clock();
+                net.Train (movie);
+                tTrain   += clock() - t0;
+                uUpdates += movie.Frames();
+                // 2.simply update neural-net with image pad
+                // net.Input (neupad);
+                // net.Update();
+            }
+        }
+    }
+    GIFSINK::Close();
+    if (_infer) {
+        cout << "train: " << uUpdates << " updates, "
+             << 1e3 * tTrain / CLOCKS_PER_SEC << " ms" << endl;
     }
 }
 
@@ -178,28 +447,6 @@ static void sPrintDebug ()
     cout << "METASTATE size: " << sizeof(METASTATE) << endl;
 }
 
-// convert an array of 4 bytes into 32-bit integer using big-endian
-//     addr+0 : b1
-//     addr+1 : b2
-//     addr+2 : b3
-//     addr+3 : b4
-// integer = b1*h1000 + b2*h0100 + b3*h0010 + b4
-static unsigned sGetInteger (unsigned char *memblock)
-{
-    unsigned result=0;
-    for (unsigned i=0; i<4; ++i) {
-        result = memblock[i] + (result << 8);
-    }
-    return result;
-}
-
-static void sReadPad (unsigned char *m, IPAD &dn)
-{
-    for (int i=0; i<dn.size(); ++i) {
-        (dn.Data())[i] = m[i];
-    }
-}
-
 
 // TESTING LOG
 // ---------------------------------------------------------------
@@ -9,38 +9,35 @@
 #include <fstream>
 #include <vector>
 #include <list>
+#include <deque>
 #include <map>
 #include <ext/hash_map>
 #include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 using namespace std;
 using namespace __gnu_cxx;
 
 
 #define foreach(i,m,n)  for(i=m; i<n; ++i)
 #define foreachv(it,v)  for(it=v.begin(); it!=v.end(); it++)
-#define foreachl(it,l)  for(list<NID>::iterator it=l->begin(); it!=l->end(); it++)
+#define foreachl(it,l)  for(FRONT::iterator it=l->begin(); it!=l->end(); it++)
 
 //namespace RING
 //{
 
 
-// const char * comparator
-struct _char_equal
-{
-  bool operator()(const char* s1, const char* s2) const
-  { return strcmp(s1, s2) == 0; }
-};
-
 // PAD is a image pad composed of 9 black/white pixels
 typedef char     PAD [9];
 // neural network types
 typedef unsigned NID;
 typedef short    NEU_POTENT;
 typedef char     NEU_STATE;
-typedef hash_map<const char *, NID, 
-                 hash<const char *>, _char_equal> hash_str;
 class IPAD;
 class IMOV;
+class IDX;
 
 
 // Note: enum consumes 4 Byte by default!
@@ -52,7 +49,6 @@ enum NEU_TYPE  { INPUT, INTERNAL, OUTPUT };
 
 // TODO:
 // - reference counter and link decay
-// - serialization of neuron net database to disk
 // - temperal association of different outputs (concepts)
 // - predicts concepts or learned associations based on output association
 
@@ -127,6 +123,8 @@ class SYNAP
     void  Weaken     () { if (_wt > 0) _wt--;  _active = 0; }
     void  Deactive   () { _active = 0;             }
     void  Aging      () { if (_age < 1000) _age++; }
+    void  AgeSet     (unsigned a) { _age = a; }
+    void  Kill       () { _wt = 0; _active = 0;    }
 
  private:
     unsigned _wt     :  8; // initial weight is 1; max : 15
@@ -137,33 +135,333 @@ class SYNAP
 };
 
 
+// LINK
+// - a synapse together with the ID of its target neuron
+// - a synapse of zero weight is a tombstone left by link removal
+class LINK
+{
+ public:
+    LINK () : _nid(0) {}
+    LINK (NID n, SYNAP s) : _nid(n),_syn(s) {}
+    NID     Nid  ()        { return _nid;              }
+    SYNAP & Syn  ()        { return _syn;              }
+    bool    Dead ()        { return _syn.Weight()==0;  }
+ private:
+    NID    _nid;
+    SYNAP  _syn;
+};
+
+
+// SLAB
+// - shared memory pool for the synapse arrays of all neurons in a NET
+// - memory is divided into pages of 64K links; each neuron owns one
+//   segment of power-of-two capacity carved out of a page;
+// - released segments are recycled through per-capacity free lists.
+class SLAB
+{
+ public:
+    SLAB  ();
+    ~SLAB ();
+    LINK * Alloc (unsigned cap);          // cap is a power of two
+    void   Free  (LINK *seg, unsigned cap);
+ private:
+    static const unsigned iPageSize = 65536;
+    static const unsigned iClasses  = 32;
+    static unsigned Class (unsigned cap);
+    vector<LINK *> _pages;    // all pages allocated so far
+    LINK         * _page;     // page to carve new segments from
+    unsigned       _used;     // links used in the current page
+    LINK         * _free[iClasses];
+};
+
+
+// LINKS
+// - outgoing synapses of a neuron, kept as an array sorted by target;
+// - the array is a segment of the shared SLAB, doubled when full;
+// - removed links are left as tombstones which iterators skip;
+//   a tombstone is revived by a new link to the same target, or
+//   compacted away when the array runs out of room.
+class LINKS
+{
+ public:
+    // iterates live links only, in ascending order of target NID
+    class iterator
+    {
+     public:
+        iterator () : _p(0),_e(0) {}
+        iterator (LINK *p, LINK *e) : _p(p),_e(e) { Skip(); }
+        LINK &   operator *  ()   { return *_p; }
+        LINK *   operator -> ()   { return  _p; }
+        iterator & operator ++()  { _p++; Skip(); return *this; }
+        iterator   operator ++(int)
+            { iterator t(*this); _p++; Skip(); return t; }
+        bool operator ==(const iterator &i) const { return _p==i._p; }
+        bool operator !=(const iterator &i) const { return _p!=i._p; }
+     private:
+        void Skip () { while (_p!=_e && _p->Dead()) _p++; }
+        LINK * _p;
+        LINK * _e;
+    };
+
+    LINKS () : _slab(0),_data(0),_size(0),_cap(0),_live(0) {}
+    void     Slab  (SLAB *s)  { _slab = s; }
+    iterator begin ()         { return iterator(_data,_data+_size);       }
+    iterator end   ()         { return iterator(_data+_size,_data+_size); }
+    unsigned size  ()         { return _live;  }
+    bool     empty ()         { return _live==0; }
+    // raw slots, including tombstones
+    LINK   * Data  ()         { return _data;  }
+    unsigned Slots ()         { return _size;  }
+    // live link to the given target; NIL if none
+    LINK   * Find  (NID);
+    // add a link to a target that is not yet linked
+    LINK   * Insert(NID, SYNAP);
+    // add links to targets in ascending order, none of which has a
+    // slot yet (not even a tombstone); one pass for the whole batch
+    void     Merge (const NID *, unsigned, SYNAP);
+    // leave a tombstone in place of the link
+    void     Erase (LINK *);
+    // take over a segment of size live links and capacity cap
+    // (a power of two, or 0); the current segment goes to the SLAB
+    void     Attach(LINK *, unsigned size, unsigned cap);
+
+ private:
+    LINK   * Lower (NID);
+    void     Grow  (unsigned n=1);
+    SLAB   * _slab;
+    LINK   * _data;
+    unsigned _size;   // used slots, including tombstones
+    unsigned _cap;    // allocated slots
+    unsigned _live;   // live links
+};
+
+
+// FLATMAP
+// - open-addressing hash table with linear probing;
+// - the slot array only holds indices into a dense entry array,
+//   so iteration is in insertion order and cache friendly;
+// - erase leaves a dead entry behind (skipped by iterators) and
+//   backward-shifts the slots; dead entries go away with Clear();
+// - Clear() costs the number of entries, not the capacity.
+struct _nid_hash
+{
+  size_t operator()(NID n) const { return n * 0x9E3779B9u; }
+};
+template <class K> struct _flat_equal
+{
+  bool operator()(const K &a, const K &b) const { return a == b; }
+};
+
+template <class K, class V, class H = _nid_hash,
+          class E = _flat_equal<K> >
+class FLATMAP
+{
+ public:
+    struct ENTRY {
+        K        first;
+        V        second;
+        unsigned _slot;    // position in the slot array
+        bool     _dead;
+    };
+    class iterator
+    {
+     public:
+        iterator () : _e(0),_end(0) {}
+        iterator (ENTRY *e, ENTRY *end) : _e(e),_end(end) { Skip(); }
+        ENTRY &    operator * () { return *_e; }
+        ENTRY *    operator ->() { return  _e; }
+        iterator & operator ++() { _e++; Skip(); return *this; }
+        iterator   operator ++(int) { iterator t=*this; ++(*this); return t; }
+        bool operator ==(const iterator &a) const { return _e==a._e; }
+        bool operator !=(const iterator &a) const { return _e!=a._e; }
+     private:
+        friend class FLATMAP;
+        void Skip () { while (_e!=_end && _e->_dead) _e++; }
+        ENTRY *_e;
+        ENTRY *_end;
+    };
+
+    FLATMAP () : _slots(16, iEmpty),_live(0) {}
+    iterator begin () { return iterator(Data(), Data()+_ents.size()); }
+    iterator end   () { return iterator(Data()+_ents.size(),
+                                        Data()+_ents.size()); }
+    unsigned size  () { return _live; }
+    iterator find  (const K &k) {
+        unsigned s = Probe(k);
+        return (_slots[s]==iEmpty) ? end() :
+            iterator(Data()+_slots[s], Data()+_ents.size());
+    }
+    V & operator [](const K &k) {
+        unsigned s = Probe(k);
+        if (_slots[s] == iEmpty) {
+            if ((_live+1)*4 > _slots.size()*3) {
+                Rehash(_slots.size()*2);
+                s = Probe(k);
+            }
+            ENTRY e;
+            e.first = k; e.second = V(); e._slot = s; e._dead = false;
+            _slots[s] = _ents.size();
+            _ents.push_back(e);
+            _live++;
+        }
+        return _ents[_slots[s]].second;
+    }
+    void erase (const K &k) {
+        iterator it = find(k);
+        if (it != end()) {
+            erase(it);
+        }
+    }
+    void erase (iterator it) {
+        unsigned hole = it._e->_slot;
+        unsigned mask = _slots.size()-1;
+        it._e->_dead = true;
+        _live--;
+        // backward shift: pull up entries displaced past the hole
+        unsigned s = (hole+1) & mask;
+        while (_slots[s] != iEmpty) {
+            ENTRY &e = _ents[_slots[s]];
+            unsigned home = Home(e.first);
+            if (((s-home) & mask) >= ((s-hole) & mask)) {
+                _slots[hole] = _slots[s];
+                e._slot = hole;
+                hole = s;
+            }
+            s = (s+1) & mask;
+        }
+        _slots[hole] = iEmpty;
+    }
+    void clear () {
+        typename vector<ENTRY>::iterator it;
+        foreachv (it, _ents) {
+            if (!(*it)._dead) {
+                _slots[(*it)._slot] = iEmpty;
+            }
+        }
+        _ents.clear();
+        _live = 0;
+    }
+
+ private:
+    enum { iEmpty = ~0u };
+    ENTRY *  Data () { return _ents.empty() ? 0 : &_ents[0]; }
+    unsigned Home (const K &k) {
+        size_t h = _hash(k);
+        return (unsigned)(h ^ (h >> 16)) & (_slots.size()-1);
+    }
+    // slot holding the key, or the empty slot where it would go
+    unsigned Probe (const K &k) {
+        unsigned mask = _slots.size()-1;
+        unsigned s = Home(k);
+        while (_slots[s]!=iEmpty && !_equal(_ents[_slots[s]].first, k)) {
+            s = (s+1) & mask;
+        }
+        return s;
+    }
+    void Rehash (unsigned size) {
+        _slots.assign(size, iEmpty);
+        unsigned i;
+        foreach (i, 0, _ents.size()) {
+            if (!_ents[i]._dead) {
+                unsigned s = Probe(_ents[i].first);
+                _slots[s] = i;
+                _ents[i]._slot = s;
+            }
+        }
+    }
+    vector<unsigned> _slots;   // power-of-two capacity
+    vector<ENTRY>    _ents;
+    unsigned         _live;
+    H                _hash;
+    E                _equal;
+};
+
+
+// ARENA
+// - bump-pointer memory for objects living through one firing round;
+// - nothing is freed individually: Reset() releases all at once;
+// - blocks are kept across Reset(), so the steady state does no
+//   malloc or free at all.
+class ARENA
+{
+ public:
+    ARENA  () : _block(0),_used(0) {}
+    ~ARENA ();
+    void * Alloc (size_t);
+    // move an allocation into a larger one
+    void * Grow  (void *, size_t used, size_t size);
+    void   Reset () { _block = 0; _used = 0; }
+ private:
+    static const size_t iBlockSize = 65536;
+    vector<pair<char *,size_t> > _blocks;
+    unsigned   _block;    // block being carved
+    size_t     _used;     // bytes used in that block
+};
+
+
 // SIGN
 // - is a signature of NIDs
+// - kept as a sorted sequence of integer keys (NID<<1 | delayed);
+// - carries a 64-bit hash, updated on each append; it is a sum of
+//   mixed keys, so it does not depend on the order of appends;
+// - equality checks the hash first, then the keys.
+// - keys are on the heap, or in an ARENA if one is given
 class SIGN
 {
  public:
-    SIGN () {}
+    SIGN () : _key(0),_size(0),_cap(0),_hash(0),_arena(0) {}
+    SIGN (ARENA *a) : _key(0),_size(0),_cap(0),_hash(0),_arena(a) {}
+    SIGN (const SIGN &a) : _key(0),_size(0),_cap(0),_hash(0),_arena(0)
+        { *this = a; }
+    ~SIGN () { if (!_arena) delete [] _key; }
     void Append     (const NID, const SYNAP);
-    bool Empty      ()              { _sig.empty(); }
-    void Clear      ()              { _sig.erase(); }
-    void operator  =(const SIGN &a) { _sig = a._sig; }
-    bool operator ==(const SIGN &a) { return (_sig.compare(a._sig)==0);}
-    const char *Cstr()              { return _sig.c_str(); }
+    bool Empty      () const        { return _size==0; }
+    void Clear      ()              { _size = 0; _hash = 0; }
+    void operator  =(const SIGN &a);
+    bool operator ==(const SIGN &a) const;
+    uint64_t Hash   () const        { return _hash; }
+    // raw keys, (NID << 1 | delayed) in ascending order
+    const unsigned * Keys () const  { return _key;  }
+    unsigned NumKeys() const        { return _size; }
+    void Assign     (const unsigned *, unsigned);
+    // print as NIDs; '*' marks delayed firing
+    void Write      (ostream &) const;
+ protected:
+    ARENA * Arena   ()              { return _arena; }
  private:
-    string   _sig;     // trigering pattern
+    void Reserve    (unsigned);
+    unsigned *       _key;     // trigering pattern
+    unsigned         _size;
+    unsigned         _cap;
+    uint64_t         _hash;
+    ARENA    *       _arena;   // NIL: keys on the heap
 };
 
+// functors to key a hash_map by signature content
+struct _sign_hash
+{
+  size_t operator()(const SIGN *s) const { return (size_t)s->Hash(); }
+};
+struct _sign_equal
+{
+  bool operator()(const SIGN *s1, const SIGN *s2) const
+  { return (*s1) == (*s2); }
+};
+typedef FLATMAP<const SIGN *, NID, _sign_hash, _sign_equal> hash_sig;
+
 
 // STAMP 
 // - is a signature of firing pattern
-// - collects the ID of contributing neurons in a string
-// - has iterator for contributing NIDs
+// - collects the ID of contributing neurons
+// - has arrays of contributing NIDs and their synapses
+// - lives in the ARENA of a BBS, with all its arrays; it is never
+//   destroyed individually, but dropped with the arena.
 class STAMP : public SIGN
 {
  public:
-    STAMP() : _strength(0) {};
-    STAMP(STAMP *s) : _strength(s->_strength),
-        _syns(s->_syns),_nids(s->_nids) {};
+    STAMP(ARENA *a) : SIGN(a),_strength(0),
+        _syns(0),_nids(0),_size(0),_cap(0) {};
+    STAMP(ARENA *a, STAMP *s);
     // attach a new ID with its strength
     void Append(const NID, const SYNAP);
     // clear all registered patterns (overloaded)
@@ -174,54 +472,69 @@ class STAMP : public SIGN
     
     unsigned        Age     ();
     unsigned        Strength()  { return _strength;  }
-    vector<SYNAP> & Synaps  ()  { return _syns;      }
-    vector<NID>   & Nids    ()  { return _nids;      }
+    unsigned        Size    ()  { return _size;      }
+    SYNAP         * Synaps  ()  { return _syns;      }
+    NID           * Nids    ()  { return _nids;      }
     
  private:
     unsigned         _strength;// combined synapse strength
-    vector<SYNAP>    _syns;    // trigering synaps
-    vector<NID>      _nids;    // trigering neurons
+    SYNAP          * _syns;    // trigering synaps
+    NID            * _nids;    // trigering neurons
+    unsigned         _size;
+    unsigned         _cap;
 };
 
 
 // BBS
 // - bulletin-board-system for unique firing patterns 
 // - decides which neuron gets to fire or shut-down
-// - operating sequence : Post - Select - Iter - Clear
+// - operating sequence : Post - Select - Winners/Losers - Filter - Clear
+// - all STAMPs of a round live in one ARENA, reset by Clear
 class NET;
 class BBS
 {
  public:
-    BBS  (NET &n) : _fIterFiring(true),_net(n) {};
+    typedef vector<pair<NID, STAMP *> > RESULT;
+    BBS  (NET &n) : _net(n) {};
     ~BBS ();
     void     Clear   ();
     unsigned Size    () { return _board.size(); }
     // register each axon action
     bool    Post     (NID src, NID dst, SYNAP s);
-    // register a combinational pattern
+    // register a combinational pattern (see Select)
     STAMP * PostComb (NID, STAMP *);
-    // pick unique patterns based on synapse strength
+    bool    GetComb  (NID, STAMP * &);
+    // pick unique patterns based on synapse strength;
+    // splits the board into winners and losers
     bool    Select   (bool);
     // retrieve the pattern of a firing neuron
     bool    GetStamp (NID, STAMP * &);
-    // iterate success firing patterns
-    void    IterBegin(bool);
-    bool    IterNext (NID &);
+    // board entries that won or lost in Select, in board order
+    RESULT & Winners () { return _winners; }
+    RESULT & Losers  () { return _losers;  }
     // remove losers from the board.
     void    Filter   ();
-    // check existence of ID
+    // check existence of ID; a bit test per call
     bool    Exists   (NID n) {
-        return (_board.find(n) != _board.end());
+        return n < _member.size()*32 && ((_member[n>>5] >> (n&31)) & 1);
     }
 
  private:
-    void Release();
     bool Compare(NID,NID,STAMP*,STAMP*);
-    bool _fIterFiring;   // 1:select winners; 0:losers
+    void Partition();
     // maps unique signature string to NID
-    hash_str                         _stamps;
-    hash_map<NID, STAMP *>           _board;
-    hash_map<NID, STAMP *>::iterator _it;
+    hash_sig                         _stamps;
+    FLATMAP<NID, STAMP *>            _board;
+    FLATMAP<NID, STAMP *>::iterator  _it;
+    // combinational patterns derived from delayed ones
+    FLATMAP<NID, STAMP *>            _comb;
+    // NIDs on the board, as a bitset
+    vector<unsigned>                 _member;
+    // outcome of Select
+    RESULT                           _winners;
+    RESULT                           _losers;
+    // storage of all STAMPs on the boards
+    ARENA                            _arena;
     // need a NET reference to retrieve neurons
     NET & _net;
 };
@@ -256,8 +569,112 @@ class DFSGRAPH
 };
 
 
+// JOURNAL
+// - append-only log of the link and signature changes made since
+//   the last snapshot (see ringJournal.cpp for the record format);
+// - records are copied into a ring buffer by the learning thread
+//   and written to the file by a background thread;
+// - Tick() closes the changes of one Update; a replay stops at the
+//   last Tick, so a crash loses at most the Update in progress.
+class JOURNAL
+{
+ public:
+    enum OP {
+        J_LINK=1,   // NEURON::Link(dst,delayed)
+        J_WEAKEN,   // NEURON::LinkWeaken(dst,delayed)
+        J_REMOVE,   // NEURON::LinkRemove(dst)
+        J_DEACTIVE, // NEURON::LinkDeactive(dst,delayed)
+        J_ASSIGN,   // NEURON::Assign: new signature keys
+        J_TICK,     // end of an Update: time, next output, rng count,
+                    // and the activity (see NET::JournalTick)
+        J_AGE       // age of a link at the end of an Update
+    };
+    JOURNAL  ();
+    ~JOURNAL ();
+    // start a log whose changes apply on top of state at time t,
+    // whose fingerprint (NET::Fingerprint) is base
+    bool Open     (const char *, long t, uint64_t base);
+    // write out all records and stop the writer
+    void Close    ();
+    void Link     (NID src, NID dst, bool d) { Put(J_LINK,src,dst,d);     }
+    void Weaken   (NID src, NID dst, bool d) { Put(J_WEAKEN,src,dst,d);   }
+    void Remove   (NID src, NID dst)         { Put(J_REMOVE,src,dst,0);   }
+    void Deactive (NID src, NID dst, bool d) { Put(J_DEACTIVE,src,dst,d); }
+    void Assign   (NID, const SIGN &);
+    void Age      (NID src, NID dst, unsigned age);
+    void Tick     (long t, NID next, uint64_t count,
+                   const vector<unsigned char> &act);
+ private:
+    enum { iRing = 1<<20 };
+    void Put      (OP, NID, NID, bool);
+    void Put      (const unsigned char *, unsigned);
+    static void * Main (void *);
+    void          Loop ();
+    int               _fd;
+    unsigned char   * _ring;     //[iRing]
+    unsigned          _head;     // bytes put; moved by the learner
+    unsigned          _tail;     // bytes written; moved by the writer
+    pthread_t         _thread;
+    pthread_mutex_t   _mutex;
+    pthread_cond_t    _more;     // wakes the writer
+    pthread_cond_t    _space;    // wakes a learner waiting for room
+    bool              _quit;
+};
+
+
 // forward declaration
 class METASTATE;
+class NEURON;
+
+
+// NEUCELL
+// - cold data of a neuron: signature, links and DFS traversal fields;
+// - kept apart from the hot firing fields held in NEUPOOL.
+class NEUCELL : public DFSNODE
+{
+ public:
+    SIGN  & Sign ()  { return _sign;  }
+    LINKS & Links()  { return _links; }
+    LINKS & InLinks(){ return _inLinks; }
+ private:
+    SIGN               _sign;
+    LINKS              _links;
+    LINKS              _inLinks;  // sources linking here (weight 1)
+};
+
+
+// NEUPOOL
+// - dense storage for all neurons of a NET;
+// - hot firing fields (potential, state, flag) live in parallel
+//   arrays, so whole-net sweeps only stream the bytes they need;
+// - a NEURON is a handle (pool, id) into this storage.
+class NEUPOOL
+{
+    friend class NEURON;
+ public:
+    NEUPOOL  (NID size);
+    ~NEUPOOL ();
+    // use the given hot arrays (e.g. a mapped snapshot) from now on;
+    // they are not owned by the pool
+    void         Attach(NEU_POTENT *, NEU_STATE *, char *, char *);
+    // log of link changes; NIL if not journaling
+    void         Journal(JOURNAL *j) { _journal = j; }
+    NID          Size  ()   { return _size;   }
+    NEU_POTENT * Potent()   { return _potent; }
+    NEU_STATE  * State ()   { return _state;  }
+    char       * Flag  ()   { return _flag;   }
+    char       * Type  ()   { return _type;   }
+    NEUCELL    * Cells ()   { return _cells;  }
+ private:
+    NID          _size;
+    NEU_POTENT * _potent;   //[size]
+    NEU_STATE  * _state;    //[size]
+    char       * _flag;     //[size]
+    char       * _type;     //[size] NEU_TYPE
+    NEUCELL    * _cells;    //[size]
+    bool         _owned;    // hot arrays allocated by the pool
+    JOURNAL    * _journal;
+};
 
 
 // NEURON 
@@ -267,12 +684,12 @@ class METASTATE;
 // - seeks connection with others that fire at the same time instance;
 // - after firing, distribute energy among connected synapses;
 // - activity quiet out in three time instances;
-class NEURON : public DFSNODE
+// - is a lightweight handle into NEUPOOL, cheap to pass by value.
+class NEURON
 {
     friend class METASTATE;
  public:
-    NEURON  () : _id(0),_type(INTERNAL),
-        _state(QUIET),_potent(0),_flag(FLAG_NONE) {}
+    NEURON  (NEUPOOL *p, NID i) : _pool(p),_id(i) {}
 
     static const char  QUIET    =0;
     static const char  AWAKE    =1;
@@ -296,33 +713,37 @@ class NEURON : public DFSNODE
 
     // access functions
     NID  Id()               { return _id;   }
-    void Id(NID i)          { _id = i;      }
-    NEU_TYPE Type()         { return _type; }
-    void Type(NEU_TYPE t)   { _type = t;    }
-    NEU_STATE State()       { return _state; }
-    void State(NEU_STATE s) { _state = s;    }
+    NEU_TYPE Type()         { return (NEU_TYPE)_pool->_type[_id]; }
+    void Type(NEU_TYPE t)   { _pool->_type[_id] = (char)t; }
+    NEU_STATE State()       { return _pool->_state[_id]; }
+    void State(NEU_STATE s) { _pool->_state[_id] = s;    }
     void StateReset(METASTATE s);
     
     // potential management
     void PotentialAdd(short w=1) 
-        { _potent+=w; if (_potent>255) _potent=255; }
+        { Potent()+=w; if (Potent()>255) Potent()=255; }
     void PotentialReset();
     void PotentialReduce();
-    NEU_POTENT Potential()  { return _potent; }
+    NEU_POTENT Potential()  { return Potent(); }
     
-    // link management
-    map<NID,SYNAP>& Links() { return _links; }
-    unsigned LinkCount()    { return _links.size(); }
-    bool Linked    (NID id) { return _links.find(id) != _links.end(); }
+    // link management;
+    // InLinks() mirrors the live links of other neurons to this one
+    LINKS & Links()         { return Cell().Links(); }
+    LINKS & InLinks()       { return Cell().InLinks(); }
+    unsigned LinkCount()    { return Links().size(); }
+    bool Linked    (NID id) { return Links().Find(id) != 0; }
     bool LinkRemove(NID);
     bool LinkWeaken  (NID, bool d=false);
     bool LinkDeactive(NID, bool d=false);
     void Link        (NID, bool d=false);
+    // link to (or strengthen) targets sorted in ascending order;
+    // the array is used as scratch
+    void LinkBatch   (NID *, unsigned, bool d=false);
     
     // 8 1-bit flags
-    void FlagSet  (FLAG f) { _flag |= (char)(f); }
-    void FlagReset(FLAG f) { _flag &= ~((char)f); }
-    bool FlagTest (FLAG f) { return _flag & ((char)f); }
+    void FlagSet  (FLAG f) { Flag() |= (char)(f); }
+    void FlagReset(FLAG f) { Flag() &= ~((char)f); }
+    bool FlagTest (FLAG f) { return Flag() & ((char)f); }
     
     // firing & cooling
     bool Excite(NEU_POTENT p);
@@ -330,22 +751,38 @@ class NEURON : public DFSNODE
     
     // check if given STAMP matches with internal SIGN
     bool Match (STAMP *pStamp) { 
-        return (_sign.Empty() || (_sign==(*pStamp)) 
+        return (Sign().Empty() || (Sign()==(*pStamp)) 
                 || (LinkCount()==0) ); 
     }
     // assign a unique pattern
-    void Assign(STAMP *pStamp) 
-        { _sign=(*pStamp); }
-    SIGN & Sign () { return _sign; }
+    void Assign(STAMP *pStamp) {
+        Sign()=(*pStamp);
+        if (_pool->_journal) _pool->_journal->Assign(_id,Sign());
+    }
+    SIGN & Sign () { return Cell().Sign(); }
+
+    // DFS traversal fields
+    unsigned TravId()           { return Cell().TravId(); }
+    void     TravId(unsigned t) { Cell().TravId(t);       }
+    unsigned Level()            { return Cell().Level();  }
+    void     Level(unsigned l)  { Cell().Level(l);        }
+    NID      Next()             { return Cell().Next();   }
+    void     Next(NID n)        { Cell().Next(n);         }
     
  private:
+    NEU_POTENT & Potent()   { return _pool->_potent[_id]; }
+    char       & Flag  ()   { return _pool->_flag[_id];   }
+    NEUCELL    & Cell  ()   { return _pool->_cells[_id];  }
+    // keep the in-index of the target in step with this neuron's links
+    void InLink   (NID nid) {
+        _pool->_cells[nid].InLinks().Insert(_id,SYNAP(1u));
+    }
+    void InUnlink (NID nid) {
+        LINKS &in = _pool->_cells[nid].InLinks();
+        in.Erase(in.Find(_id));
+    }
+    NEUPOOL          * _pool;
     NID                _id;
-    NEU_TYPE           _type;
-    char               _flag;
-    NEU_STATE          _state;
-    NEU_POTENT         _potent;
-    SIGN               _sign;
-    map<NID,SYNAP>     _links;
 };
 
 
@@ -356,8 +793,8 @@ class METASTATE
     friend class NEURON;
  public:
     METASTATE() { u._data = 0; }
-    METASTATE(const NEURON &n) {
-        u.s._flag=n._flag; u.s._state=n._state; u.s._potent=n._potent; 
+    METASTATE(NEURON n) {
+        u.s._flag=n.Flag(); u.s._state=n.State(); u.s._potent=n.Potent();
     }
     METASTATE(const METASTATE &m) { u._data = m.u._data; }
     void operator =(const METASTATE m) { u._data=m.u._data;  }
@@ -377,6 +814,283 @@ class METASTATE
 
 
 
+// FRONT
+// - a firing queue: ordered NIDs in a dense vector, paired with a
+//   membership bitset over all neurons, so a NID is queued once;
+// - filtering is done by compaction, walking the vector with a
+//   write cursor: Keep() the survivors, Drop() the rest, then Resize();
+// - storage is retained across Clear(), so steady-state firing
+//   rounds do not allocate.
+class FRONT
+{
+ public:
+    typedef vector<NID>::iterator iterator;
+    FRONT (NID size) : _bits((size+31)/32, 0) {}
+    iterator begin ()          { return _nids.begin(); }
+    iterator end   ()          { return _nids.end();   }
+    unsigned size  ()          { return _nids.size();  }
+    bool     empty ()          { return _nids.empty(); }
+    NID      operator [](unsigned i) { return _nids[i]; }
+    NID      back  ()          { return _nids.back();  }
+    NID    * Data  ()          { return _nids.empty() ? 0 : &_nids[0]; }
+    bool     Has   (NID n)     { return (_bits[n>>5] >> (n&31)) & 1; }
+    // append unless already queued; return true if appended
+    bool     Push  (NID n) {
+        if (Has(n)) return false;
+        _bits[n>>5] |= (1u << (n&31));
+        _nids.push_back(n);
+        return true;
+    }
+    void     PopBack () { Drop(_nids.back()); _nids.pop_back(); }
+    // compaction: survivors are written at the cursor, in order
+    void     Keep  (unsigned i, NID n) { _nids[i] = n; }
+    void     Drop  (NID n)     { _bits[n>>5] &= ~(1u << (n&31)); }
+    void     Resize(unsigned n){ _nids.resize(n); }
+    void     Clear () {
+        foreachv (_it, _nids) { Drop(*_it); }
+        _nids.clear();
+    }
+ private:
+    vector<NID>      _nids;
+    vector<unsigned> _bits;
+    iterator         _it;
+};
+
+// RANK
+// - orders a FRONT by potential, highest first, in O(n);
+// - potentials are capped at 255, so a counting sort over 256
+//   buckets needs no comparisons;
+// - stable: neurons with equal potential keep their queue order;
+// - owns its scratch space, one per NET, so NETs stay reentrant.
+class RANK
+{
+ public:
+    void Sort (FRONT *, const NEU_POTENT *);
+ private:
+    static const unsigned iBuckets = 256;
+    unsigned    _count[iBuckets];
+    vector<NID> _sorted;
+};
+
+// ENERGY
+// - splits the energy of a firing neuron among its links,
+//   in proportion to link weight: share = energy * w / total;
+// - fixed-point kernels, vectorized where the cpu allows;
+//   all of them give the same result as SplitScalar for energy
+//   < 256, w < 256 and total < 65536;
+// - Split() picks the widest kernel at run time, and the division
+//   outside that range.
+namespace ENERGY
+{
+    typedef unsigned short WEIGHT;
+    void Split       (unsigned energy, unsigned total,
+                      const WEIGHT *w, unsigned *share, unsigned n);
+    void SplitScalar (unsigned energy, unsigned total,
+                      const WEIGHT *w, unsigned *share, unsigned n);
+    void SplitSSE2   (unsigned energy, unsigned total,
+                      const WEIGHT *w, unsigned *share, unsigned n);
+    void SplitAVX2   (unsigned energy, unsigned total,
+                      const WEIGHT *w, unsigned *share, unsigned n);
+    // float path formerly used by Propagate (for benchmarking)
+    void SplitFloat  (unsigned energy, unsigned total,
+                      const WEIGHT *w, unsigned *share, unsigned n);
+    // name of the kernel picked by Split()
+    const char * Kernel ();
+}
+
+// RNG
+// - counter-based random numbers: the n-th number of a stream is a
+//   hash (splitmix64) of the stream key and n; there is no shared
+//   state to lock, and numbers can be drawn in any order;
+// - Split() derives an independent substream, which gives the same
+//   numbers whoever draws them; only BenchFire uses one (for its
+//   graph), as the firing workers draw no random numbers.
+class RNG
+{
+ public:
+    RNG (uint64_t seed=0) : _key(Mix(seed)),_count(0) {}
+    uint64_t At    (uint64_t n) const
+        { return Mix(_key + (n+1) * 0x9E3779B97F4A7C15ULL); }
+    uint64_t Next64()           { return At(_count++); }
+    unsigned Next  ()           { return (unsigned)(Next64() >> 32); }
+    // uniform in [0,n)
+    unsigned Below (unsigned n) 
+        { return (unsigned)(((uint64_t)Next() * n) >> 32); }
+    RNG      Split (uint64_t stream) const {
+        RNG r;
+        r._key = Mix(_key ^ Mix(stream + 0x632BE59BD9B4E019ULL));
+        return r;
+    }
+    // stream state, for snapshots
+    uint64_t Key   () const     { return _key;   }
+    uint64_t Count () const     { return _count; }
+    void     Restore(uint64_t k, uint64_t c) { _key = k; _count = c; }
+    static uint64_t Mix (uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+ private:
+    uint64_t _key;     // identifies the stream
+    uint64_t _count;   // numbers drawn so far
+};
+
+// SPREAD
+// - the links a firing neuron sends energy through, and the share
+//   of energy for each; scratch space of one propagating thread.
+struct SPREAD
+{
+    vector<LINK *>         _links;
+    vector<ENERGY::WEIGHT> _weight;
+    vector<unsigned>       _share;
+};
+
+// FIREBUF
+// - scratch of one worker of the parallel firing (ringThread.cpp):
+//   the links it walked, filed by the worker that owns their target,
+//   with the link range each piece came from;
+// - the pieces of all workers into its own targets, in slot order,
+//   and the links among them into firing neurons before their turn.
+struct FIREBUF
+{
+    struct CUT {
+        unsigned _beg;      // first slot of the range
+        unsigned _worker;   // whose _out
+        unsigned _from, _to;
+        bool operator < (const CUT &c) const { return _beg < c._beg; }
+    };
+    SPREAD                    _spread;
+    vector<vector<uint64_t> > _out;   //[workers] target<<32 | slot
+    vector<vector<CUT> >      _cuts;  //[workers] pieces of _out
+    vector<CUT>               _in;    // pieces into own targets
+    vector<uint64_t>          _early; // position<<32 | slot, ascending
+};
+
+// FROZEN
+// - read-only view of a trained NET for recognition (ringInfer.cpp):
+//   the immediate links in CSR form with the weight total of each
+//   source, both ways, and the immediate part of each signature;
+// - plus the scratch of one query, reset sparsely after each, and
+//   of one batch, with a bit lane per image (64 images a word).
+struct FROZEN
+{
+    enum MATCH { NEVER=0, SIGN, ANY };
+    // a source spreading the same energy in a set of lanes
+    struct BURST { NID _src; unsigned _energy; uint64_t _lanes; };
+    // a candidate in the competition of one lane
+    struct PICK
+    {
+        unsigned _lane;
+        uint64_t _pattern;   // hash of the sources that reached it
+        unsigned _potent;
+        NID      _nid;
+        // by pattern, then higher potential, then lower id
+        bool operator< (const PICK &p) const {
+            if (_lane    != p._lane)    return _lane    < p._lane;
+            if (_pattern != p._pattern) return _pattern < p._pattern;
+            if (_potent  != p._potent)  return _potent  > p._potent;
+            return _nid < p._nid;
+        }
+    };
+    vector<unsigned>       _off;      //[TSIZE+1] links of each source
+    vector<NID>            _dst;
+    vector<ENERGY::WEIGHT> _weight;
+    vector<char>           _inSign;   // source is in the target's sign
+    vector<unsigned>       _total;    //[TSIZE]
+    vector<unsigned>       _inOff;    //[TSIZE+1] links into each target
+    vector<NID>            _src;
+    vector<unsigned>       _signOff;  //[TSIZE+1] signature of each
+    vector<NID>            _sign;     // sorted sources
+    vector<char>           _match;    //[TSIZE] MATCH
+    // scratch of a query
+    vector<unsigned>       _potent;   //[TSIZE]
+    vector<unsigned>       _hits;     //[TSIZE] sources in signature
+    vector<char>           _miss;     //[TSIZE] a source outside it
+    vector<char>           _fired;    //[TSIZE]
+    vector<uint64_t>       _pattern;  //[TSIZE] hash of the sources
+    vector<NID>            _touched;
+    vector<NID>            _wave;
+    vector<unsigned>       _energy;   // of the wave, before it spreads
+    vector<NID>            _next;
+    vector<NID>            _cand;
+    vector<PICK>           _pick;
+    vector<unsigned>       _share;
+    vector<NID>            _outputs;
+    // scratch of a batch, a word of lanes per neuron
+    vector<uint64_t>       _bPotent;  //[TSIZE*8] bit planes, low first
+    vector<uint64_t>       _bFired;   //[TSIZE]
+    vector<uint64_t>       _bFire;    //[TSIZE] firing in this wave
+    vector<uint64_t>       _bSpread;  //[TSIZE] spreading in this wave
+    vector<uint64_t>       _bReach;   //[TSIZE] reached in this wave
+    vector<uint64_t>       _bMiss;    //[TSIZE] ... from outside the sign
+    vector<BURST>          _burst;
+};
+
+// TPOOL
+// - a fixed set of worker threads running one TASK at a time;
+// - the calling thread takes part as worker 0.
+class TPOOL
+{
+ public:
+    class TASK
+    {
+     public:
+        virtual ~TASK () {}
+        virtual void Work (unsigned worker) = 0;
+    };
+    TPOOL  (unsigned size);
+    ~TPOOL ();
+    unsigned Size () { return _size; }
+    // every worker runs the task once; returns when all are done
+    void     Run  (TASK *);
+ private:
+    struct ARG { TPOOL *_pool; unsigned _worker; };
+    static void * Main (void *);
+    void          Loop (unsigned worker);
+    unsigned          _size;
+    vector<pthread_t> _threads;
+    vector<ARG>       _args;
+    pthread_mutex_t   _mutex;
+    pthread_cond_t    _start;
+    pthread_cond_t    _done;
+    TASK            * _task;
+    unsigned          _round;  // bumped for every task
+    unsigned          _busy;   // workers yet to finish the round
+    bool              _quit;
+};
+
+// STEAL
+// - work-stealing TASK over an index space [0,n), for work of very
+//   uneven cost per index (e.g. links of a few dominant neurons);
+// - each worker owns a deque of ranges, seeded with an equal slice;
+//   it halves its range down to the grain, works on the lower half
+//   and leaves the upper halves in its deque;
+// - an idle worker steals the oldest (largest) range of another.
+class STEAL : public TPOOL::TASK
+{
+ public:
+    STEAL (TPOOL &pool, unsigned grain)
+        : _pool(pool),_grain(grain ? grain : 1),_left(0) {}
+    // call Range() over all of [0,n), on all workers
+    void Run   (unsigned n);
+    virtual void Range (unsigned worker, unsigned beg, unsigned end) = 0;
+    void Work  (unsigned worker);
+ private:
+    struct RANGE { unsigned _beg; unsigned _end; };
+    struct DEQUE {
+        DEQUE () : _lock(0) {}
+        volatile int  _lock;     // spin lock
+        deque<RANGE>  _ranges;
+    };
+    void Push  (unsigned w, RANGE r);
+    bool Pop   (unsigned w, RANGE &r);
+    bool Steal (unsigned w, RANGE &r);
+    TPOOL           & _pool;
+    unsigned          _grain;
+    vector<DEQUE>     _deques;
+    volatile unsigned _left;     // indices not yet done
+};
+
 // NET 
 // - is a collection of NEURON, which:
 // - (1) a subset are designated to receive input 
@@ -391,7 +1105,9 @@ class METASTATE
 class NET : public DFSGRAPH
 {
  public:
-    NET  (NID);
+    // same seed, same run, with or without threads: only
+    // RandomFire draws, on the calling thread
+    NET  (NID, uint64_t seed=1234567);
     ~NET ();
     const NID RSIZE; //=1;
     const NID ISIZE; //=9;
@@ -406,20 +1122,53 @@ class NET : public DFSGRAPH
     static const short MAX_FIRE=1000;
 
     unsigned Verbose     ()   { return _verbose; }
+    RNG    & Rng         ()   { return _rng;     }
+    // number of threads for real firing; 0 keeps it sequential
+    void     Threads     (unsigned);
+    // time real firing on a generated skewed graph, for 1..n threads
+    void     BenchFire   (unsigned n);
     void     Advance     ()   { _time ++; }
     void     Input       (PAD);
+    // the cost goes with the pixels that are on or turned off
     void     Input       (IPAD &);
+    // sparse input: the distinct input neurons that are on; those on
+    // in the previous frame and not listed are quieted
+    void     Input       (const NID *, unsigned);
+    // input by change: a bit per input neuron, set where the pixel
+    // flipped since the previous frame (e.g. from IPAD::Delta)
+    void     InputDelta  (const uint64_t *);
+    // pixels at or above the threshold excite their input neuron
+    void     Threshold   (unsigned char t) { _threshold = t;    }
+    unsigned char Threshold ()             { return _threshold; }
     void     Train       (IMOV &);
+    void     Train       (IPAD &);
     void     Update      ();
     void     Report      ();
     void     ReportState (NEU_STATE st);
     void     Cool        ();
     void     WriteGif    ();
     void     WriteDot    ();
+    // binary snapshot of the whole learning state (see ringSave.cpp);
+    // Load expects a fresh NET of the same size
+    bool     Save        (const char *);
+    bool     Load        (const char *);
+    // log link changes from now on, on top of the last snapshot
+    // (see ringJournal.cpp); replay such a log after Load
+    bool     Journal     (const char *);
+    bool     Replay      (const char *);
+    // hash of the whole state a journal builds on
+    uint64_t Fingerprint ();
+    // recognition on a frozen copy of the links (see ringInfer.cpp):
+    // the output neurons one image activates, in ascending order;
+    // Update drops the frozen copy, the next Infer takes a new one
+    void     Freeze      ();
+    const vector<NID> & Infer (IPAD &);
+    // the same for many images at once, 64 per pass
+    void     Infer       (const vector<IPAD *> &, vector< vector<NID> > &);
     bool     IsInput     (NID id) { return (id>=0 && id<ISIZE); }
-    NEURON & Get(NID id) {
-        if (id>=0&&id<TSIZE) return _neurons[id];
-        cout<<id<<endl; assert(0); return _neurons[0];
+    NEURON   Get(NID id) {
+        if (id>=0&&id<TSIZE) return NEURON(&_pool,id);
+        cout<<id<<endl; assert(0); return NEURON(&_pool,0);
     }
     int          GetNumLevels();
     vector<NID>* Levelize();
@@ -427,8 +1176,10 @@ class NET : public DFSGRAPH
     // register a neuron state and revert it;
     // (could be done inside a neuron, but do it here
     //  for memory concern)
-    void     StateRegister (NEURON &n);
-    void     StateRevert   (NEURON &n);
+    // a neuron is logged at most once per epoch; StateClear() 
+    // starts a new epoch instead of wiping the log entries.
+    void     StateRegister (NEURON n);
+    void     StateRevert   (NEURON n);
     void     StateClear    ();
     
     // compare the potential of two neurons
@@ -440,62 +1191,188 @@ class NET : public DFSGRAPH
     enum FIRING_TYPE { 
         FIRING_INPUT, FIRING_CURRENT, FIRING_DELAYED 
     };
-    bool       Update         (NEURON &n,list<NID> *q=0,bool d=0);
-    bool       Propagate      (NEURON &n,list<NID> *q,bool d=0);
-    void       Connect        (NEURON &n,list<NID> *q,bool d=0);
+    bool       Update         (NEURON n,FRONT *q=0,bool d=0);
+    bool       Propagate      (NEURON n,FRONT *q,bool d=0);
+    unsigned   Spread         (NEURON n,bool f,bool d,SPREAD &);
+    // parallel real firing (see ringThread.cpp)
+    bool       Fire           (const NID *,unsigned,FRONT *q,bool d=0);
+    void       FireTotal      (unsigned w,unsigned beg,unsigned end,bool d);
+    void       FireSplit      (SPREAD &,unsigned beg,unsigned end,bool d);
+    void       FireShares     (SPREAD &,unsigned s,unsigned beg,
+                               unsigned end,unsigned energy,bool d);
+    void       FireMerge      (unsigned worker);
+    void       FireResolve    (const NID *,unsigned,bool d);
+    void       FireExcite     (unsigned worker);
+    void       FireAge        (unsigned beg,unsigned end);
+    // up to 64 images of a batch, one per lane (see ringInfer.cpp)
+    void       InferLanes     (IPAD *const *,unsigned,vector<NID> *);
+    void       Connect        (NEURON n,FRONT *q,bool d=0);
     void       ConnectOutput  (const NID);
     void       RandomFire     ();
     void       RealFire       (FIRING_TYPE);
-    void       Sort           (list<NID> *);
+    void       Sort           (FRONT *);
     void       CoolCurrQueue  ();
     void       CoolPrioQueue  ();
     void       CoolOutput     ();
-    void       ProcessFiring  (FIRING_TYPE type, list<NID> *qFiring=0);
+    void       ProcessFiring  (FIRING_TYPE type, FRONT *qFiring=0);
     bool       ProcessFiringQueue();
     NID        NextOutput     () 
         { _nextOutput++; return (NSIZE+_nextOutput-1); }
+    // input neurons on in the last frame, from _on or from the states
+    void       InputActive    ();
+    void       InputScan      ();
+    // close the journal records of an Update (see ringJournal.cpp)
+    void       JournalTick    ();
+    // unchecked access for internal sweeps
+    NEURON     Neu            (NID id) { return NEURON(&_pool,id); }
 
  private:
-    NEURON    * _neurons;  //[TSIZE];
+    NEUPOOL     _pool;     // all neurons [TSIZE]
     NID       * _inputs ;  //[ISIZE];
     NID       * _outputs;  //[OSIZE];
     NID         _nextOutput;
+    vector<uint64_t> _on;     //[ISIZE/64] inputs on in the last frame
+    vector<NID>      _active; // the same, ascending
+    SLAB        _slab;     // synapse storage of all neurons
     
-    list<NID>  _random;     // 0.5% random firing
-    list<NID>* _firingPrio; // neurons that fire in prio round
-    list<NID>* _firingCurr; // neurons that fire currently
-    list<NID>* _firingWavf; // neurons in the firing wave front
-    list<NID>* _firingWavb; // neurons in the firing wave back
-    list<NID>  _firingBake; // remaining from >2 rounds before
+    RNG         _rng;       // random stream of this NET
+    vector<NID> _random;    // 0.5% random firing
+    FRONT    * _firingPrio; // neurons that fire in prio round
+    FRONT    * _firingCurr; // neurons that fire currently
+    FRONT    * _firingWavf; // neurons in the firing wave front
+    FRONT    * _firingWavb; // neurons in the firing wave back
+    FRONT      _firingBake; // remaining from >2 rounds before
     BBS        _bbs;        // bulletin board of firing pattern
-    hash_map<NID,METASTATE> 
-        _record;            // register neuron states
+    RANK       _rank;       // orders the firing queue by potential
+    SPREAD                 _spread; // scratch of Propagate
+    // scratch of Connect: in-neighbours marked with the current stamp
+    vector<unsigned>       _mark;
+    unsigned               _markStamp;
+    vector<NID>            _targets;
+    // parallel firing: workers and their scratch; the firing
+    // neurons by position, and the links of those with any laid end
+    // to end in one index space of slots, cut at _srcEnd
+    friend class FIRESTEAL;
+    friend class FIREPART;
+    static const unsigned  NO_SHARE = ~0u;
+    enum { POS_STALE=1, POS_FIRES=2 };    // _posMark
+    enum { SRC_AGED=1, SRC_IGNITES=2 };   // _srcMark
+    enum { SLOT_HYPER=1, SLOT_QUEUES=2 }; // _slotHyper
+    TPOOL                * _tpool;
+    vector<FIREBUF>        _bufs;     // per worker
+    vector<unsigned>       _order;    //[TSIZE] position + 1; 0 if none
+    vector<unsigned char>  _posMark;  // excited earlier; fires
+    vector<unsigned>       _posBase;  // first slot from the position on
+    vector<NID>            _sources;  // neurons with links
+    vector<unsigned>       _srcPos;   // their positions
+    vector<unsigned>       _srcEnd;   // end of each source's links
+    vector<unsigned>       _srcTotal; // weight of links to fire through
+    vector<unsigned char>  _srcMark;  // aged a link; ignited a target
+    vector<unsigned>       _slotShare;// share of each slot, or NO_SHARE
+    vector<unsigned char>  _slotHyper;// target HYPER after its excite
+    vector<NID>            _igniting; // sources of a delayed firing
+
+    // undo log of neuron states (see StateRegister)
+    struct UNDO { unsigned _epoch; unsigned _pos; };
+    UNDO     * _undoAt;     //[TSIZE] epoch and log position
+    unsigned   _epoch;      // current epoch
+    vector<pair<NID,METASTATE> >
+               _undo;       // registered neuron states
 
     long       _time;
     unsigned   _verbose;
+    unsigned char _threshold; // of an input pixel being on
+
+    // mapped snapshot the neurons point into; NIL if none
+    void     * _snap;
+    size_t     _snapSize;
+    JOURNAL  * _journal;
+    FRONT      _aged;       // sources whose links aged in this Update
+    // activity as of the last Tick; a Tick logs only what changed
+    vector<NEU_POTENT>    _jrnlPotent;
+    vector<NEU_STATE>     _jrnlState;
+    vector<char>          _jrnlFlag;
+    vector<unsigned char> _jrnlAct;   // scratch of JournalTick
+    FROZEN   * _frozen;     // NIL until Freeze
 };
 
 
 class WORK 
 {
  public:
-    WORK () :_mnist(false) {}
+    WORK () :_mnist(false),_bench(false),_threads(0),_seed(1234567),
+              _save(0),_load(0),_journal(0),_replay(0),
+              _labels(0),_first(0),_count(5),_stride(1),_epochs(1),
+              _threshold(128),_pipe(false),_gifs(0),
+              _infer(false),_batch(false) {}
     
     void GenTrainingSet ();
+    void BenchEnergy    ();
+    void BenchFiring    ();
     void TrainPad   (NET &,const char *);
     void TrainMnist (NET &,const char *);
+    bool Resume     (NET &);
     
     void mnist(bool m)   { _mnist = true; }
     bool mnist()         { return _mnist; }
     void verbose(bool m) { _verb  = true; }
     bool verbose()       { return _verb;  }
+    void bench(bool b)   { _bench = b;    }
+    bool bench()         { return _bench; }
+    void threads(unsigned n) { _threads = n;    }
+    unsigned threads()       { return _threads; }
+    void seed(uint64_t s)    { _seed = s;       }
+    uint64_t seed()          { return _seed;    }
+    void save(const char *f) { _save = f;       }
+    const char * save()      { return _save;    }
+    void load(const char *f) { _load = f;       }
+    const char * load()      { return _load;    }
+    void journal(const char *f) { _journal = f;   }
+    const char * journal()      { return _journal; }
+    void replay(const char *f)  { _replay = f;    }
+    const char * replay()       { return _replay;  }
+    // MNIST samples: labels file, range, stride and epochs
+    void labels(const char *f)  { _labels = f;    }
+    void first (unsigned n)     { _first  = n;    }
+    void count (unsigned n)     { _count  = n;    }
+    void stride(unsigned n)     { _stride = n ? n : 1; }
+    void epochs(unsigned n)     { _epochs = n;    }
+    // grey level from which a pixel is on
+    void threshold(unsigned char t) { _threshold = t;    }
+    unsigned char threshold()       { return _threshold; }
+    // make the training frames on a second thread (see FRAMEFEED)
+    void pipe  (bool b)         { _pipe   = b;    }
+    // write every N-th training frame as GIF, 0 for none
+    void gifs  (unsigned n)     { _gifs   = n;    }
+    // recognize the samples after training
+    void infer (bool b)         { _infer  = b;    }
+    void batch (bool b)         { _batch  = b;    }
 
  protected:
-    void ProcessMnist (NET &,unsigned char *memblock);
+    void ProcessMnist (NET &,IDX &,IDX *);
+    void InferMnist   (NET &,IDX &,IDX *);
+    void WriteOutputs (unsigned,IDX *,const vector<NID> &);
 
  private:
     bool  _mnist;
     bool  _verb;
+    bool  _bench;
+    unsigned _threads;
+    uint64_t _seed;
+    const char * _save;   // snapshot written after training
+    const char * _load;   // snapshot to resume from
+    const char * _journal;// log of link changes while training
+    const char * _replay; // log to replay on top of the snapshot
+    const char * _labels;
+    unsigned _first;
+    unsigned _count;
+    unsigned _stride;
+    unsigned _epochs;
+    unsigned char _threshold;
+    bool     _pipe;
+    unsigned _gifs;
+    bool     _infer;
+    bool     _batch;
 };
 
 
@@ -535,17 +1412,43 @@ namespace PADS
 }
 
 
+// ROTMAP
+// - gather table of one rotation (width, height, angle) about the
+//   pad centre: each pixel takes the nearest source pixel, or blends
+//   the 4 around its source point (bilinear, 14-bit fixed point);
+// - built once per (width, height, angle, sampling) and cached for
+//   the life of the process (see imgPads.cpp).
+class ROTMAP
+{
+ public:
+    enum SAMPLE { NEAREST, BILINEAR };
+    static const ROTMAP * Get (unsigned w, unsigned h, double angle,
+                               SAMPLE s=BILINEAR);
+    // dst and src are distinct pads of the table's size
+    void Apply (const unsigned char *src, unsigned char *dst) const;
+ private:
+    ROTMAP (unsigned w, unsigned h, double angle, SAMPLE s);
+    unsigned               _size;
+    unsigned               _taps;  // source pixels per pixel, 1 or 4
+    vector<unsigned>       _src;   //[size*taps]
+    vector<unsigned short> _wt;    //[size*taps] weights, 1<<14 in all
+                                   // (NEAREST: 1 if inside the pad)
+};
+
 // IPAD is an image pad 
 // composed of 28 X 28 (784) grey scale pixels [0,255]
 class IPAD
 {
  public:
     IPAD  (unsigned w, unsigned h) :
-        _width(w),_height(h),_size(w*h) {
+        _width(w),_height(h),_size(w*h),_own(true) {
         _data = new unsigned char [_size];
     }
+    // a view of pixels owned elsewhere (e.g. a mapped IDX file)
+    IPAD  (unsigned w, unsigned h, unsigned char *data) :
+        _width(w),_height(h),_size(w*h),_data(data),_own(false) {}
     IPAD  (IPAD &p);
-    ~IPAD () { delete [] _data; }
+    ~IPAD () { if (_own) delete [] _data; }
     // pad size is constant once constructed
     const unsigned width () { return _width;  }
     const unsigned height() { return _height; }
@@ -559,6 +1462,14 @@ class IPAD
         }
     }
     unsigned char * &Data() { return _data; }
+    // bit-packed binarized view: bit i%64 of word i/64 is set if
+    // pixel i is at or above thresh; valid until the next call
+    const uint64_t * Bits (unsigned char thresh);
+    unsigned        Words () { return (_size+63)/64; }
+    // bits of the pixels that are on in one of this pad and prev only,
+    // binarizing both; NIL if the sizes differ; valid until the next
+    // call of Bits
+    const uint64_t * Delta (IPAD &prev, unsigned char thresh);
     // scale up or down the image pad
     bool Scale     (IPAD &);
     bool ScaleUp   (unsigned);
@@ -568,9 +1479,14 @@ class IPAD
     bool ShiftRight(unsigned);
     bool ShiftUp   (unsigned);
     bool ShiftDown (unsigned);
-    // in-place rotation (counter clockwise)
-    bool Rotate (double);
+    // rotation (counter clockwise) through a cached ROTMAP, in place
+    // or from a pad of the same size
+    bool Rotate (double, ROTMAP::SAMPLE s=ROTMAP::BILINEAR);
+    bool Rotate (IPAD &, double, ROTMAP::SAMPLE s=ROTMAP::BILINEAR);
     void Clear  ();
+    // exchange pixels with a pad of the same size, without copying;
+    // false for views
+    bool Swap   (IPAD &);
     // write out image in GIF format
     void WriteGif ();
 
@@ -611,11 +1527,27 @@ class IPAD
     const unsigned  _height;
     const unsigned  _size  ;
     unsigned char * _data  ;
+    bool            _own   ;  // false for a view
+    vector<uint64_t> _bits ;  // of Bits()
 };
 
-// IMOV is a collection of image pad frames, as a movie
-// composed of 28 X 28 (784) grey scale pixels [0,255]
-// TODO: improve memory efficiency with memory pool
+// IPOOL
+// - free image pads by size, handed out again instead of a new and
+//   delete per frame; the pads are kept for the life of the process
+//   (see imgPads.cpp).
+class IPOOL
+{
+ public:
+    // a pad of w x h owning its pixels, which are not cleared
+    static IPAD * Get (unsigned w, unsigned h);
+    static void   Put (IPAD *);
+};
+
+// IMOV is a movie of image pad frames made from one pad
+// - a list of moves (base, move, amount), kept instead of the frames;
+// - a frame is made only when pulled by Next, into one of two pads
+//   from IPOOL, so the previous frame stays valid (e.g. for
+//   IPAD::Delta).
 class IMOV
 {
  public:
@@ -626,15 +1558,211 @@ class IMOV
         ROTATE, SCALED, SHIFTU, SHIFTD, SHIFTL, SHIFTR,
         NONE,
     };
-    vector<IPAD*> & ipads() { return _ipads; }
-    // append a frame at the end
-    bool AddIpad (IPAD *,MTYPE,unsigned);
+    // append a move at the end, made from the pad scaled down by
+    // reduce (1: the pad as given, 0: a blank pad)
+    bool AddIpad (MTYPE, unsigned, unsigned reduce=1);
     // expand the ipad into a movie by a sequence of moves
     // e.g. shifting, scaling, rotating
     bool Roll ();
+    // the next frame, NIL at the end; valid until the second call
+    // after, so the frame before stays valid as well
+    IPAD *   Next   ();
+    void     Rewind () { _next = 0; _frames = 0; }
+    // frames made since the start
+    unsigned Frames () { return _frames; }
 
  private:
-    vector<IPAD*> _ipads;
+    struct STEP {
+        MTYPE    type;
+        unsigned amount;
+        unsigned reduce;
+    };
+    IPAD *   Base (unsigned reduce);
+    IPAD         _pad;      // copy of the source pad
+    vector<STEP> _steps;
+    unsigned     _next;     // of _steps
+    unsigned     _frames;
+    IPAD *       _frame[2]; // last made, and the one before
+    IPAD *       _base;     // _pad scaled down by _reduce
+    unsigned     _reduce;
+};
+
+// IDX
+// - a file in the IDX format of the MNIST sets: magic 0x0000TTDD
+//   (TT the data type, DD the dimensions), DD big-endian sizes,
+//   then the data, big-endian, first dimension outermost;
+// - the file is mapped (private pages, read sequentially), and the
+//   samples along the first dimension are used in place.
+class IDX
+{
+ public:
+    enum DTYPE {
+        UBYTE=0x08, SBYTE=0x09, SHORT=0x0B, INT=0x0C,
+        FLOAT=0x0D, DOUBLE=0x0E
+    };
+    IDX  () : _map(0),_size(0),_data(0),_type(0),_elem(0),_sample(0) {}
+    ~IDX () { Close(); }
+    bool     Open   (const char *);
+    void     Close  ();
+    unsigned Type   ()           { return _type;        }
+    unsigned Dims   ()           { return _dims.size(); }
+    unsigned Dim    (unsigned d) { return _dims[d];     }
+    unsigned Count  ()           { return _dims.empty() ? 0 : _dims[0]; }
+    // bytes of one sample
+    size_t   Bytes  ()           { return _sample;      }
+    // raw bytes of sample i
+    unsigned char * Sample (unsigned i) { return _data + i*_sample; }
+    // element k of sample i, whatever the data type
+    double   Value  (unsigned i, size_t k=0);
+ private:
+    void           * _map;
+    size_t           _size;
+    unsigned char  * _data;
+    unsigned         _type;
+    size_t           _elem;    // bytes per element
+    size_t           _sample;  // bytes per sample
+    vector<unsigned> _dims;
+};
+
+// IDXFEED
+// - hands out the samples first, first+stride, ... of an IDX file,
+//   count of them (0: up to the end);
+// - a prefetch thread faults in the pages of the samples ahead of
+//   the learner, so it does not wait on the disk.
+class IDXFEED
+{
+ public:
+    IDXFEED  (IDX &, unsigned first, unsigned count, unsigned stride,
+              unsigned ahead=64);
+    ~IDXFEED ();
+    unsigned Size () { return _count; }
+    // index of the next sample; false when all are handed out
+    bool     Next (unsigned &);
+ private:
+    static void * Main (void *);
+    void          Loop ();
+    IDX            & _idx;
+    unsigned         _first;
+    unsigned         _count;
+    unsigned         _stride;
+    unsigned         _ahead;
+    unsigned         _pos;     // samples handed out
+    bool             _quit;
+    bool             _running;
+    pthread_t        _thread;
+    pthread_mutex_t  _mutex;
+    pthread_cond_t   _moved;   // the learner took a sample
+};
+
+// SPSC
+// - bounded ring of items from one producer thread to one consumer
+//   thread, without locks: each side writes only its own index, and
+//   a barrier orders the slot before the index that hands it over;
+// - holds up to size-1 items.
+template <class T> class SPSC
+{
+ public:
+    SPSC (unsigned size) : _slots(size < 2 ? 2 : size),_head(0),_tail(0) {}
+    unsigned Capacity () { return _slots.size() - 1; }
+    unsigned Count () {
+        unsigned h = _head, t = _tail;
+        return (t + _slots.size() - h) % _slots.size();
+    }
+    // false if full (producer only)
+    bool Push (const T &x) {
+        unsigned t = _tail, n = (t + 1) % _slots.size();
+        if (n == _head) {
+            return false;
+        }
+        _slots[t] = x;
+        __sync_synchronize();
+        _tail = n;
+        return true;
+    }
+    // false if empty (consumer only)
+    bool Pop (T &x) {
+        unsigned h = _head;
+        if (h == _tail) {
+            return false;
+        }
+        __sync_synchronize();
+        x = _slots[h];
+        __sync_synchronize();
+        _head = (h + 1) % _slots.size();
+        return true;
+    }
+ private:
+    vector<T>         _slots;
+    volatile unsigned _head;     // next to pop, by the consumer
+    char              _line[64]; // keep the indices apart
+    volatile unsigned _tail;     // next to push, by the producer
+};
+
+// FRAMEFEED
+// - the training frames of IDX samples, made on a producer thread:
+//   each sample is scaled to a size x size pad and rolled into an
+//   IMOV, whose frames are handed through an SPSC ring;
+// - the trainer pulls frames with Next and gives each pad back with
+//   Done once it is trained on;
+// - throughput of both sides and the ring occupancy go to Report.
+class FRAMEFEED
+{
+ public:
+    struct FRAME {
+        IPAD   * _pad;      // NIL at the end
+        unsigned _sample;
+        bool     _first;    // of a movie
+    };
+    FRAMEFEED  (IDX &, unsigned size, unsigned first, unsigned count,
+                unsigned stride, unsigned epochs, unsigned ring=256);
+    ~FRAMEFEED ();
+    // false after the last frame
+    bool Next   (FRAME &);
+    void Done   (IPAD *);
+    void Report (ostream &);
+ private:
+    static void * Main (void *);
+    void          Loop ();
+    IDX            & _idx;
+    unsigned         _size;
+    unsigned         _first;
+    unsigned         _count;
+    unsigned         _stride;
+    unsigned         _epochs;
+    SPSC<FRAME>      _ring;
+    volatile bool    _quit;
+    bool             _running;
+    bool             _end;
+    pthread_t        _thread;
+    // by the producer
+    unsigned         _samples;
+    unsigned         _made;
+    double           _tMake;    // ms making frames
+    double           _tFull;    // ms waiting on a full ring
+    // by the consumer
+    unsigned         _taken;
+    uint64_t         _occupied; // sum of the ring counts at Next
+    unsigned         _peak;
+    double           _tEmpty;   // ms waiting on an empty ring
+    double           _tStart;
+};
+
+// GIFSINK
+// - debug images of the training frames (gif/inN.gif): none, the
+//   default, every N-th frame, or all of them;
+// - a frame is copied into a pooled pad and written out by an encoder
+//   thread, through an SPSC ring; with the ring full the frame is
+//   dropped rather than waited for, so training never waits on it;
+// - frames come from one thread at a time (the trainer, or the
+//   FRAMEFEED thread).
+class GIFSINK
+{
+ public:
+    // 0: off, 1: all, N: every N-th frame
+    static void Every (unsigned n);
+    static void Put   (IPAD &);
+    // write out the frames still queued and stop the encoder
+    static void Close ();
 };
 
 